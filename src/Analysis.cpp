@@ -15,6 +15,10 @@
  */
 
 #include "Analysis.h"
+#include "Input.h"
+#include "Partition.h"
+#include "Profile.h"
+#include <array>
 #include <filesystem>
 
 static void StrongConnect(std::vector<Component*> &stack, size_t& index, Component* c) {
@@ -74,6 +78,7 @@ void KillComponent(std::unordered_map<std::string, Component *> &components, con
     for (auto& c : components) {
       c.second->pubDeps.erase(target);
       c.second->privDeps.erase(target);
+      c.second->includeReasons.erase(target);
       c.second->circulars.clear();
     }
     delete target;
@@ -102,6 +107,7 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
                                std::map<std::string, std::vector<std::string>> &ambiguous,
                                std::unordered_map<std::string, Component *> &components, 
                                std::unordered_map<std::string, File>& files) {
+    uint64_t localHits = 0, lookupHits = 0, misses = 0, ambiguities = 0;
     for (auto &fp : files) {
         for (auto &p : fp.second.rawIncludes) {
             // If this is a non-pointy bracket include, see if there's a local match first. 
@@ -110,8 +116,14 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
             if (!p.second && files.count(fullFilePath)) {
                 // This file exists as a local include.
                 File* dep = &files.find(fullFilePath)->second;
+                localHits++;
                 dep->hasInclude = true;
-                fp.second.dependencies.insert(dep);
+                if (fp.second.dependencies.insert(dep).second) {
+                    dep->includedBy.insert(&fp.second);
+                    if (fp.second.component && dep->component && fp.second.component != dep->component) {
+                        fp.second.component->includeReasons[dep->component].push_back(std::make_pair(&fp.second, dep));
+                    }
+                }
             } else {
                 // We need to use an include path to find this. So let's see where we end up.
                 std::string lowercaseInclude;
@@ -120,6 +132,7 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
                 if (fullPath == "INVALID") {
                     // We end up in more than one place. That's an ambiguous include then.
                     ambiguous[lowercaseInclude].push_back(fp.first);
+                    ambiguities++;
                 } else if (fullPath.find("GENERATED:") == 0) {
                     // We end up in a virtual file - it's not actually there yet, but it'll be generated.
                     if (fp.second.component) {
@@ -131,7 +144,13 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
                     }
                 } else if (files.count(fullPath)) {
                     File *dep = &files.find(fullPath)->second;
-                    fp.second.dependencies.insert(dep);
+                    lookupHits++;
+                    if (fp.second.dependencies.insert(dep).second) {
+                        dep->includedBy.insert(&fp.second);
+                        if (fp.second.component != dep->component) {
+                            fp.second.component->includeReasons[dep->component].push_back(std::make_pair(&fp.second, dep));
+                        }
+                    }
 
                     std::string inclpath = fullPath.substr(0, fullPath.size() - p.first.size() - 1);
                     if (inclpath.size() == dep->component->root.generic_string().size()) {
@@ -151,11 +170,17 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
                         dep->hasExternalInclude = true;
                     }
                     dep->hasInclude = true;
+                } else {
+                    // We don't know about it. Probably a system include of some sort.
+                    misses++;
                 }
-                // else we don't know about it. Probably a system include of some sort.
             }
         }
     }
+    CountProfile("local include hits", localHits);
+    CountProfile("include lookup hits", lookupHits);
+    CountProfile("include lookup misses", misses);
+    CountProfile("ambiguous includes", ambiguities);
 }
 
 void PropagateExternalIncludes(std::unordered_map<std::string, File>& files) {
@@ -176,3 +201,793 @@ void PropagateExternalIncludes(std::unordered_map<std::string, File>& files) {
 }
 
 
+
+FileGraph BuildFileGraph(std::unordered_map<std::string, File>& files) {
+    FileGraph fg;
+    fg.files.reserve(files.size());
+    fg.index.reserve(files.size());
+    for (auto &fp : files) {
+        fg.index[&fp.second] = fg.files.size();
+        fg.files.push_back(&fp.second);
+    }
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    for (size_t n = 0; n < fg.files.size(); n++) {
+        for (auto &dep : fg.files[n]->dependencies) {
+            edgeList.push_back(std::make_pair(n, fg.index[dep]));
+        }
+    }
+    fg.graph = MakeDigraph(fg.files.size(), std::move(edgeList));
+    return fg;
+}
+
+ComponentGraph BuildComponentGraph(std::unordered_map<std::string, Component *> &components) {
+    ComponentGraph cg;
+    for (auto &c : components) {
+        if (c.second) cg.components.push_back(c.second);
+    }
+    std::sort(cg.components.begin(), cg.components.end(), [](const Component* a, const Component* b) { return a->root < b->root; });
+    for (size_t n = 0; n < cg.components.size(); n++) {
+        cg.index[cg.components[n]] = n;
+    }
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    for (size_t n = 0; n < cg.components.size(); n++) {
+        for (auto &d : cg.components[n]->pubDeps) {
+            if (cg.index.count(d)) edgeList.push_back(std::make_pair(n, cg.index[d]));
+        }
+        for (auto &d : cg.components[n]->privDeps) {
+            if (cg.index.count(d)) edgeList.push_back(std::make_pair(n, cg.index[d]));
+        }
+    }
+    cg.graph = MakeDigraph(cg.components.size(), std::move(edgeList));
+    return cg;
+}
+
+void CalculateIncludeSizes(std::unordered_map<std::string, File>& files) {
+    FileGraph fg = BuildFileGraph(files);
+    Condensation c = Condense(fg.graph);
+    // All files in a cycle include the same set of files, so sum up per strongly connected component.
+    std::vector<uint64_t> locs(c.size(), 0), roots(c.size(), 0);
+    for (size_t n = 0; n < fg.files.size(); n++) {
+        locs[c.componentOf[n]] += fg.files[n]->loc;
+        if (!fg.files[n]->hasInclude) {
+            roots[c.componentOf[n]]++;
+        }
+    }
+    std::vector<uint64_t> includeCounts = ReachingWeightSums(c, roots);
+    std::vector<uint64_t> totals = ReachableWeightSums(c, locs);
+    for (size_t n = 0; n < fg.files.size(); n++) {
+        fg.files[n]->includeCount = includeCounts[c.componentOf[n]];
+        fg.files[n]->transitiveLoc = totals[c.componentOf[n]];
+    }
+}
+
+std::vector<Hotspot> FindHotspots(std::unordered_map<std::string, File>& files,
+                                  const std::unordered_map<File *, size_t>& changes, double months) {
+    FileGraph fg = BuildFileGraph(files);
+    Condensation c = Condense(fg.graph);
+    std::vector<uint64_t> units(c.size(), 0), unitLocs(c.size(), 0);
+    for (size_t n = 0; n < fg.files.size(); n++) {
+        if (IsCompileableFile(fg.files[n]->path.extension().string())) {
+            units[c.componentOf[n]]++;
+            unitLocs[c.componentOf[n]] += fg.files[n]->loc;
+        }
+    }
+    std::vector<uint64_t> reachingUnits = ReachingWeightSums(c, units);
+    std::vector<uint64_t> reachingLocs = ReachingWeightSums(c, unitLocs);
+    std::vector<Hotspot> hotspots;
+    for (auto &change : changes) {
+        auto it = fg.index.find(change.first);
+        if (it == fg.index.end() || change.second == 0) continue;
+        const size_t comp = c.componentOf[it->second];
+        Hotspot h;
+        h.file = change.first;
+        h.changes = change.second;
+        // A cyclic component already counts itself as reaching itself.
+        h.compileUnits = reachingUnits[comp] + (c.cyclic[comp] ? 0 : units[comp]);
+        h.compileLoc = reachingLocs[comp] + (c.cyclic[comp] ? 0 : unitLocs[comp]);
+        h.rebuildsPerMonth = h.changes * h.compileUnits / months;
+        hotspots.push_back(h);
+    }
+    std::sort(hotspots.begin(), hotspots.end(), [](const Hotspot& a, const Hotspot& b) {
+        if (a.rebuildsPerMonth != b.rebuildsPerMonth) return a.rebuildsPerMonth > b.rebuildsPerMonth;
+        return a.file->path < b.file->path;
+    });
+    return hotspots;
+}
+
+File *ResolveInclude(std::unordered_map<std::string, File>& files,
+                     const std::unordered_map<std::string, std::string> &includeLookup,
+                     const File &from, const std::string &include, bool withPointyBrackets) {
+    if (!withPointyBrackets) {
+        auto local = files.find((from.path.parent_path() / include).generic_string());
+        if (local != files.end()) {
+            return &local->second;
+        }
+    }
+    std::string lowercaseInclude;
+    std::transform(include.begin(), include.end(), std::back_inserter(lowercaseInclude), ::tolower);
+    auto it = includeLookup.find(lowercaseInclude);
+    if (it == includeLookup.end() || it->second == "INVALID") {
+        return NULL;
+    }
+    auto target = files.find(it->second);
+    return target == files.end() ? NULL : &target->second;
+}
+
+std::unordered_set<File *> CollectTransitiveIncluders(const std::vector<File *> &roots) {
+    std::unordered_set<File *> found(roots.begin(), roots.end());
+    std::vector<File *> todo(found.begin(), found.end());
+    while (!todo.empty()) {
+        File *f = todo.back();
+        todo.pop_back();
+        for (auto &includer : f->includedBy) {
+            if (found.insert(includer).second) {
+                todo.push_back(includer);
+            }
+        }
+    }
+    return found;
+}
+
+std::vector<RedundantInclude> FindRedundantIncludes(std::unordered_map<std::string, File>& files) {
+    FileGraph fg = BuildFileGraph(files);
+    Condensation c = Condense(fg.graph);
+    std::vector<std::vector<RedundantInclude>> found(WorkerCount());
+    // A dependency is redundant if the component of another dependency reaches it. Each
+    // (file, dependency) pair is looked at only in the block holding the dependency's component.
+    // Dependencies in the file's own cycle reach everything the file does, so they never count.
+    ForEachReachabilityBlock(c, [&](size_t first, size_t last, const std::vector<uint64_t>& reach, size_t words, size_t worker) {
+        for (size_t n = 0; n < fg.files.size(); n++) {
+            const size_t self = c.componentOf[n];
+            for (const size_t* d = fg.graph.begin(n); d != fg.graph.end(n); ++d) {
+                const size_t target = c.componentOf[*d];
+                if (target < first || target >= last) continue;
+                const uint64_t bit = uint64_t(1) << ((target - first) % 64);
+                for (const size_t* e = fg.graph.begin(n); e != fg.graph.end(n); ++e) {
+                    const size_t via = c.componentOf[*e];
+                    if (via < first || via == target || via == self) continue;
+                    if (reach[(via - first) * words + (target - first) / 64] & bit) {
+                        RedundantInclude r = { fg.files[n], fg.files[*d], fg.files[*e] };
+                        found[worker].push_back(r);
+                        break;
+                    }
+                }
+            }
+        }
+    });
+    std::vector<RedundantInclude> result;
+    for (auto &f : found) {
+        result.insert(result.end(), f.begin(), f.end());
+    }
+    std::sort(result.begin(), result.end(), [](const RedundantInclude& a, const RedundantInclude& b) {
+        return a.file->path < b.file->path || (a.file->path == b.file->path && a.target->path < b.target->path);
+    });
+    return result;
+}
+
+// Per-worker state for FindGatewayHeaders, indexed by file graph node.
+struct DominatorScratch {
+    std::vector<size_t> number;
+    std::vector<uint64_t> dominatedLoc, dominatedFiles;
+    std::vector<size_t> roots;
+};
+
+// Cooper, Harvey and Kennedy's iterative dominator algorithm on the files reachable from root,
+// adding what each file dominates to the totals in scratch.
+static void AddDominatedFiles(const FileGraph& fg, const Digraph& reverse, size_t root, DominatorScratch& scratch) {
+    const size_t unset = static_cast<size_t>(-1);
+    std::vector<size_t> postorder;
+    std::vector<std::pair<size_t, size_t>> stack(1, std::make_pair(root, fg.graph.edgeStart[root]));
+    scratch.number[root] = 0;
+    while (!stack.empty()) {
+        const size_t node = stack.back().first;
+        if (stack.back().second < fg.graph.edgeStart[node + 1]) {
+            const size_t next = fg.graph.edges[stack.back().second++];
+            if (scratch.number[next] == unset) {
+                scratch.number[next] = 0;
+                stack.push_back(std::make_pair(next, fg.graph.edgeStart[next]));
+            }
+        } else {
+            postorder.push_back(node);
+            stack.pop_back();
+        }
+    }
+    // Number the reachable files in reverse postorder, so the root is 0 and every file comes after its dominators.
+    const size_t count = postorder.size();
+    std::vector<size_t> order(postorder.rbegin(), postorder.rend());
+    for (size_t i = 0; i < count; i++) {
+        scratch.number[order[i]] = i;
+    }
+    std::vector<size_t> idom(count, unset);
+    idom[0] = 0;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < count; i++) {
+            size_t newIdom = unset;
+            for (const size_t* p = reverse.begin(order[i]); p != reverse.end(order[i]); ++p) {
+                size_t pred = scratch.number[*p];
+                if (pred == unset || idom[pred] == unset) continue;
+                if (newIdom == unset) {
+                    newIdom = pred;
+                    continue;
+                }
+                while (pred != newIdom) {
+                    while (pred > newIdom) pred = idom[pred];
+                    while (newIdom > pred) newIdom = idom[newIdom];
+                }
+            }
+            if (idom[i] != newIdom) {
+                idom[i] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    std::vector<uint64_t> loc(count), files(count, 1);
+    for (size_t i = 0; i < count; i++) {
+        loc[i] = fg.files[order[i]]->loc;
+    }
+    for (size_t i = count; i-- > 1;) {
+        loc[idom[i]] += loc[i];
+        files[idom[i]] += files[i];
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (files[i] > 1) {
+            scratch.dominatedLoc[order[i]] += loc[i];
+            scratch.dominatedFiles[order[i]] += files[i];
+            scratch.roots[order[i]]++;
+        }
+    }
+    for (auto &node : order) {
+        scratch.number[node] = unset;
+    }
+}
+
+std::vector<GatewayHeader> FindGatewayHeaders(std::unordered_map<std::string, File>& files, const std::vector<File *>& roots) {
+    FileGraph fg = BuildFileGraph(files);
+    Digraph reverse = ReverseDigraph(fg.graph);
+    const size_t n = fg.files.size();
+    std::vector<DominatorScratch> scratch(WorkerCount());
+    for (auto &s : scratch) {
+        s.number.assign(n, static_cast<size_t>(-1));
+        s.dominatedLoc.assign(n, 0);
+        s.dominatedFiles.assign(n, 0);
+        s.roots.assign(n, 0);
+    }
+    ParallelFor(roots.size(), [&](size_t r, size_t worker) {
+        AddDominatedFiles(fg, reverse, fg.index.find(roots[r])->second, scratch[worker]);
+    });
+    std::vector<GatewayHeader> gateways;
+    for (size_t node = 0; node < n; node++) {
+        GatewayHeader g = { fg.files[node], 0, 0, 0 };
+        for (auto &s : scratch) {
+            g.dominatedLoc += s.dominatedLoc[node];
+            g.dominatedFiles += s.dominatedFiles[node];
+            g.roots += s.roots[node];
+        }
+        if (g.roots > 0) {
+            gateways.push_back(g);
+        }
+    }
+    std::sort(gateways.begin(), gateways.end(), [](const GatewayHeader& a, const GatewayHeader& b) {
+        return a.dominatedLoc > b.dominatedLoc || (a.dominatedLoc == b.dominatedLoc && a.file->path < b.file->path);
+    });
+    return gateways;
+}
+
+// Longest weighted chain from every group down through its dependencies, including the group itself.
+static std::vector<size_t> LongestChains(const Digraph& dag, const std::vector<size_t>& weight) {
+    std::vector<size_t> chain(dag.size(), 0);
+    for (size_t g = 0; g < dag.size(); g++) {
+        size_t longest = 0;
+        for (const size_t* it = dag.begin(g); it != dag.end(g); ++it) {
+            longest = std::max(longest, chain[*it]);
+        }
+        chain[g] = weight[g] + longest;
+    }
+    return chain;
+}
+
+BuildLevels CalculateBuildLevels(std::unordered_map<std::string, Component *> &components, bool weighByCompileUnits) {
+    ComponentGraph cg = BuildComponentGraph(components);
+    const std::vector<Component *> &comps = cg.components;
+    Condensation c = Condense(cg.graph);
+
+    BuildLevels levels;
+    levels.groups.resize(c.size());
+    levels.level.assign(c.size(), 0);
+    levels.weight.assign(c.size(), 0);
+    levels.levelCount = 0;
+    for (size_t g = 0; g < c.size(); g++) {
+        for (size_t m = c.memberStart[g]; m < c.memberStart[g + 1]; m++) {
+            Component *comp = comps[c.members[m]];
+            levels.groups[g].push_back(comp);
+            if (weighByCompileUnits) {
+                for (auto &f : comp->files) {
+                    if (IsCompileableFile(f->path.extension().string())) levels.weight[g]++;
+                }
+            } else {
+                levels.weight[g] += comp->loc();
+            }
+        }
+        std::sort(levels.groups[g].begin(), levels.groups[g].end(), [](const Component* a, const Component* b) { return a->root < b->root; });
+        for (const size_t* it = c.dag.begin(g); it != c.dag.end(g); ++it) {
+            levels.level[g] = std::max(levels.level[g], levels.level[*it] + 1);
+        }
+        levels.levelCount = std::max(levels.levelCount, levels.level[g] + 1);
+    }
+
+    std::vector<size_t> chain = LongestChains(c.dag, levels.weight);
+    levels.criticalWeight = 0;
+    size_t top = 0;
+    for (size_t g = 0; g < c.size(); g++) {
+        if (chain[g] > levels.criticalWeight) {
+            levels.criticalWeight = chain[g];
+            top = g;
+        }
+    }
+    if (levels.criticalWeight == 0) {
+        return levels;
+    }
+    for (size_t g = top;;) {
+        levels.criticalPath.push_back(g);
+        size_t next = g;
+        for (const size_t* it = c.dag.begin(g); it != c.dag.end(g); ++it) {
+            if (next == g || chain[*it] > chain[next]) next = *it;
+        }
+        if (next == g) break;
+        g = next;
+    }
+
+    // Taking a group off the critical path helps only as far as the next-heaviest chain allows.
+    for (auto &g : levels.criticalPath) {
+        std::vector<size_t> weight = levels.weight;
+        weight[g] = 0;
+        std::vector<size_t> without = LongestChains(c.dag, weight);
+        const size_t remaining = *std::max_element(without.begin(), without.end());
+        if (remaining < levels.criticalWeight) {
+            levels.splitGains.push_back(std::make_pair(g, levels.criticalWeight - remaining));
+        }
+    }
+    std::stable_sort(levels.splitGains.begin(), levels.splitGains.end(), [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+        return a.second > b.second;
+    });
+    return levels;
+}
+
+SplitSuggestion SuggestSplit(const Component &component, size_t parts) {
+    std::vector<File *> files(component.files.begin(), component.files.end());
+    std::sort(files.begin(), files.end(), [](const File* a, const File* b) { return a->path < b->path; });
+    std::unordered_map<File *, size_t> index;
+    std::vector<uint64_t> weights;
+    for (auto &f : files) {
+        index[f] = weights.size();
+        // Files without code still belong somewhere, so nothing weighs less than a line.
+        weights.push_back(std::max<size_t>(f->loc, 1));
+    }
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    for (size_t n = 0; n < files.size(); n++) {
+        for (auto &d : files[n]->dependencies) {
+            auto it = index.find(d);
+            if (it != index.end() && it->second != n) edgeList.push_back(std::make_pair(n, it->second));
+        }
+    }
+    Digraph graph = MakeDigraph(files.size(), std::move(edgeList));
+    std::vector<size_t> part = PartitionGraph(MakeWeightedGraph(graph, std::move(weights)), parts);
+
+    SplitSuggestion split;
+    split.parts.resize(parts);
+    split.partLoc.assign(parts, 0);
+    split.crossIncludes.assign(parts, std::vector<size_t>(parts, 0));
+    split.internalIncludes = graph.edges.size();
+    for (size_t n = 0; n < files.size(); n++) {
+        split.parts[part[n]].push_back(files[n]);
+        split.partLoc[part[n]] += files[n]->loc;
+        for (const size_t* it = graph.begin(n); it != graph.end(n); ++it) {
+            if (part[n] != part[*it]) split.crossIncludes[part[n]][part[*it]]++;
+        }
+    }
+    return split;
+}
+
+// Whether to can be reached from from without using the direct dependency between them.
+static bool ReachableAroundDirectLink(Component *from, Component *to) {
+    std::unordered_set<Component *> seen;
+    std::vector<Component *> todo;
+    for (auto &deps : { &from->pubDeps, &from->privDeps }) {
+        for (auto &d : *deps) {
+            if (d != to && seen.insert(d).second) todo.push_back(d);
+        }
+    }
+    while (!todo.empty()) {
+        Component *c = todo.back();
+        todo.pop_back();
+        for (auto &deps : { &c->pubDeps, &c->privDeps }) {
+            for (auto &d : *deps) {
+                if (d == to) return true;
+                if (d != from && seen.insert(d).second) todo.push_back(d);
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<MergeSuggestion> SuggestMerges(const std::vector<Component *> &candidates) {
+    std::vector<MergeSuggestion> result;
+    for (auto &c : candidates) {
+        std::unordered_map<Component *, size_t> coupling;
+        for (auto &r : c->includeReasons) {
+            coupling[r.first] += r.second.size();
+        }
+        for (auto &links : { &c->pubLinks, &c->privLinks }) {
+            for (auto &l : *links) {
+                auto it = l->includeReasons.find(c);
+                if (it != l->includeReasons.end()) coupling[l] += it->second.size();
+            }
+        }
+        bool found = false;
+        MergeSuggestion best = { c, NULL, 0, false };
+        for (auto &p : coupling) {
+            if (p.first == c || p.second == 0) continue;
+            MergeSuggestion option = { c, p.first, p.second,
+                                       ReachableAroundDirectLink(c, p.first) || ReachableAroundDirectLink(p.first, c) };
+            // Prefer merges without cycles, then the strongest coupling.
+            if (!found || option.createsCycle < best.createsCycle ||
+                (option.createsCycle == best.createsCycle &&
+                 (option.includes > best.includes ||
+                  (option.includes == best.includes && option.partner->root < best.partner->root)))) {
+                best = option;
+                found = true;
+            }
+        }
+        if (found) result.push_back(best);
+    }
+    std::sort(result.begin(), result.end(), [](const MergeSuggestion& a, const MergeSuggestion& b) {
+        return a.component->root < b.component->root;
+    });
+    return result;
+}
+
+// Angle bracket includes of f that do not resolve to a file in the project, such as system headers.
+static std::vector<std::string> ExternalIncludes(const File &f) {
+    std::vector<std::string> external;
+    for (auto &i : f.rawIncludes) {
+        if (!i.second) continue;
+        const std::string suffix = "/" + i.first;
+        bool resolved = false;
+        for (auto &d : f.dependencies) {
+            const std::string path = d->path.generic_string();
+            if (path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                resolved = true;
+                break;
+            }
+        }
+        if (!resolved) external.push_back(i.first);
+    }
+    return external;
+}
+
+// The way the given sources most often include a header through the include path, as "<x>" or [["x"]] so that
+// CMake passes it on as written, or an empty string if they only include it relative to the includer.
+static std::string IncludeSpelling(const File &header, const std::unordered_map<File *, size_t> &sources) {
+    std::string lowerPath;
+    const std::string path = header.path.generic_string();
+    std::transform(path.begin(), path.end(), std::back_inserter(lowerPath), ::tolower);
+    std::map<std::pair<std::string, bool>, size_t> spellings;
+    for (auto &includer : header.includedBy) {
+        if (!sources.count(includer)) continue;
+        for (auto &i : includer->rawIncludes) {
+            if (!i.second && (includer->path.parent_path() / i.first) == header.path) continue;
+            std::string lowerInclude;
+            std::transform(i.first.begin(), i.first.end(), std::back_inserter(lowerInclude), ::tolower);
+            if (lowerPath.size() > lowerInclude.size() &&
+                lowerPath.compare(lowerPath.size() - lowerInclude.size(), lowerInclude.size(), lowerInclude) == 0 &&
+                lowerPath[lowerPath.size() - lowerInclude.size() - 1] == '/') {
+                spellings[i]++;
+            }
+        }
+    }
+    const std::pair<const std::pair<std::string, bool>, size_t> *best = NULL;
+    for (auto &s : spellings) {
+        if (!best || s.second > best->second) best = &s;
+    }
+    if (!best) return "";
+    return best->first.second ? "<" + best->first.first + ">" : "[[\"" + best->first.first + "\"]]";
+}
+
+std::vector<std::string> SelectPrecompiledHeaders(const Component &component, uint64_t budget, uint64_t externalHeaderLoc) {
+    std::vector<File *> units;
+    for (auto &f : component.files) {
+        if (IsCompileableFile(f->path.extension().string())) units.push_back(f);
+    }
+    if (units.size() < 2 || budget == 0) return {};
+
+    std::unordered_map<File *, std::vector<std::string>> externals;
+    auto closure = [&externals](File *root, std::unordered_set<File *> &reached, std::set<std::string> &external) {
+        std::vector<File *> todo = { root };
+        reached.insert(root);
+        while (!todo.empty()) {
+            File *f = todo.back();
+            todo.pop_back();
+            auto it = externals.find(f);
+            if (it == externals.end()) it = externals.emplace(f, ExternalIncludes(*f)).first;
+            external.insert(it->second.begin(), it->second.end());
+            for (auto &d : f->dependencies) {
+                if (reached.insert(d).second) todo.push_back(d);
+            }
+        }
+    };
+
+    // Headers by the number of units that reach them, and every file that a unit reaches.
+    std::unordered_map<File *, size_t> users, reachedFiles;
+    std::map<std::string, size_t> externalUsers;
+    for (auto &u : units) {
+        std::unordered_set<File *> reached;
+        std::set<std::string> external;
+        closure(u, reached, external);
+        for (auto &f : reached) {
+            if (!IsCompileableFile(f->path.extension().string())) users[f]++;
+            reachedFiles[f]++;
+        }
+        for (auto &e : external) {
+            externalUsers[e]++;
+        }
+    }
+
+    struct Candidate {
+        std::string name;
+        File *file;
+        uint64_t cost;
+        size_t users;
+    };
+    std::vector<Candidate> candidates;
+    for (auto &u : users) {
+        if (u.second * 2 >= units.size()) {
+            std::string name = u.first->component == &component ? u.first->path.lexically_relative(component.root).generic_string()
+                                                                 : IncludeSpelling(*u.first, reachedFiles);
+            if (name.empty()) continue;
+            candidates.push_back(Candidate{ name, u.first, u.first->loc + u.first->transitiveLoc, u.second });
+        }
+    }
+    for (auto &u : externalUsers) {
+        if (u.second * 2 >= units.size()) {
+            candidates.push_back(Candidate{ u.first, NULL, externalHeaderLoc, u.second });
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.users * a.cost != b.users * b.cost) return a.users * a.cost > b.users * b.cost;
+        return a.name < b.name;
+    });
+
+    std::vector<const Candidate *> selected;
+    std::unordered_set<File *> covered;
+    std::set<std::string> coveredExternal;
+    uint64_t spent = 0;
+    for (auto &c : candidates) {
+        if (c.file ? covered.count(c.file) > 0 : coveredExternal.count(c.name) > 0) continue;
+        if (c.cost == 0 || spent + c.cost > budget) continue;
+        if (c.file) {
+            std::unordered_set<File *> reached;
+            std::set<std::string> external;
+            closure(c.file, reached, external);
+            // Earlier picks that this header pulls in anyway no longer need their own entry.
+            selected.erase(std::remove_if(selected.begin(), selected.end(), [&](const Candidate *s) {
+                bool subsumed = s->file ? reached.count(s->file) > 0 : external.count(s->name) > 0;
+                if (subsumed) spent -= s->cost;
+                return subsumed;
+            }), selected.end());
+            covered.insert(reached.begin(), reached.end());
+            coveredExternal.insert(external.begin(), external.end());
+        } else {
+            coveredExternal.insert(c.name);
+        }
+        selected.push_back(&c);
+        spent += c.cost;
+    }
+
+    std::vector<std::string> external, local;
+    for (auto &s : selected) {
+        if (s->file) local.push_back(s->name);
+        else external.push_back("<" + s->name + ">");
+    }
+    std::sort(external.begin(), external.end());
+    std::sort(local.begin(), local.end());
+    external.insert(external.end(), local.begin(), local.end());
+    return external;
+}
+
+static const size_t unityHashCount = 16;
+typedef std::array<uint64_t, unityHashCount> MinHash;
+
+// A hash of the path that is the same on every platform, so that regenerated batches do not depend on the build.
+static uint64_t StablePathHash(const File *f, size_t seed) {
+    uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+    for (char c : f->path.generic_string()) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    return h ^ (h >> 33);
+}
+
+// MinHash signatures of the sets of files every unit transitively includes. The minimum over a set is the minimum
+// over its parts, so one pass over the condensed include graph gives all of them.
+static std::vector<MinHash> UnitSignatures(const std::vector<File *> &units) {
+    std::unordered_map<File *, size_t> index;
+    std::vector<File *> nodes;
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (auto &u : units) {
+        if (index.emplace(u, nodes.size()).second) nodes.push_back(u);
+    }
+    for (size_t n = 0; n < nodes.size(); n++) {
+        for (auto &d : nodes[n]->dependencies) {
+            auto it = index.emplace(d, nodes.size());
+            if (it.second) nodes.push_back(d);
+            edges.push_back(std::make_pair(n, it.first->second));
+        }
+    }
+    Condensation c = Condense(MakeDigraph(nodes.size(), edges));
+    MinHash empty;
+    empty.fill(UINT64_MAX);
+    std::vector<MinHash> sccSignatures(c.size(), empty);
+    // Every edge goes to a lower component number, so those are complete when they are needed.
+    for (size_t scc = 0; scc < c.size(); scc++) {
+        MinHash &sig = sccSignatures[scc];
+        for (size_t m = c.memberStart[scc]; m < c.memberStart[scc + 1]; m++) {
+            for (size_t i = 0; i < unityHashCount; i++) {
+                sig[i] = std::min(sig[i], StablePathHash(nodes[c.members[m]], i));
+            }
+        }
+        for (const size_t *next = c.dag.begin(scc); next != c.dag.end(scc); ++next) {
+            for (size_t i = 0; i < unityHashCount; i++) {
+                sig[i] = std::min(sig[i], sccSignatures[*next][i]);
+            }
+        }
+    }
+    // A unit itself is never shared with the other units, so leave it out of its own set.
+    std::vector<MinHash> signatures(units.size(), empty);
+    for (size_t n = 0; n < units.size(); n++) {
+        for (auto &d : units[n]->dependencies) {
+            const MinHash &dep = sccSignatures[c.componentOf[index[d]]];
+            for (size_t i = 0; i < unityHashCount; i++) {
+                signatures[n][i] = std::min(signatures[n][i], dep[i]);
+            }
+        }
+    }
+    return signatures;
+}
+
+std::vector<std::vector<File *>> GroupUnityBatches(const Component &component, size_t batchSize) {
+    std::vector<File *> units;
+    for (auto &f : component.files) {
+        if (IsCompileableFile(f->path.extension().string())) units.push_back(f);
+    }
+    std::sort(units.begin(), units.end(), [](const File *a, const File *b) { return a->path < b->path; });
+    std::vector<std::vector<File *>> batches;
+    if (units.empty() || batchSize == 0) return batches;
+
+    const size_t n = units.size();
+    std::vector<MinHash> signatures = UnitSignatures(units);
+    // Units that share a minimum hash value at some position share at least the file it came from.
+    std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> buckets(unityHashCount);
+    for (size_t u = 0; u < n; u++) {
+        for (size_t i = 0; i < unityHashCount; i++) {
+            buckets[i][signatures[u][i]].push_back(u);
+        }
+    }
+
+    // Grow every batch from the first unit left, each time adding the unit whose include set overlaps most with
+    // what the batch includes so far. Only a bounded number of units per bucket is looked at for every pick.
+    const size_t scanLimit = 64;
+    std::vector<bool> assigned(n, false);
+    std::vector<size_t> seen(n, 0);
+    size_t nextSeed = 0, stamp = 0;
+    while (nextSeed < n) {
+        std::vector<File *> batch = { units[nextSeed] };
+        assigned[nextSeed] = true;
+        MinHash batchSignature = signatures[nextSeed];
+        while (batch.size() < batchSize) {
+            stamp++;
+            size_t best = n, bestScore = 0;
+            for (size_t i = 0; i < unityHashCount; i++) {
+                std::vector<size_t> &bucket = buckets[i][batchSignature[i]];
+                size_t scanned = 0;
+                for (size_t b = 0; b < bucket.size() && scanned < scanLimit;) {
+                    size_t u = bucket[b];
+                    if (assigned[u]) {
+                        bucket[b] = bucket.back();
+                        bucket.pop_back();
+                        continue;
+                    }
+                    b++;
+                    scanned++;
+                    if (seen[u] == stamp) continue;
+                    seen[u] = stamp;
+                    size_t score = 0;
+                    for (size_t j = 0; j < unityHashCount; j++) {
+                        if (signatures[u][j] == batchSignature[j]) score++;
+                    }
+                    if (score > bestScore || (score == bestScore && u < best)) {
+                        best = u;
+                        bestScore = score;
+                    }
+                }
+            }
+            if (best == n) {
+                // Nothing left that shares an include with this batch; fill up in path order.
+                best = nextSeed;
+                while (best < n && assigned[best]) best++;
+                if (best == n) break;
+            }
+            assigned[best] = true;
+            batch.push_back(units[best]);
+            for (size_t i = 0; i < unityHashCount; i++) {
+                batchSignature[i] = std::min(batchSignature[i], signatures[best][i]);
+            }
+        }
+        std::sort(batch.begin(), batch.end(), [](const File *a, const File *b) { return a->path < b->path; });
+        batches.push_back(batch);
+        while (nextSeed < n && assigned[nextSeed]) nextSeed++;
+    }
+    return batches;
+}
+
+static bool IsHeaderOnly(const Component &component) {
+    for (auto &f : component.files) {
+        if (IsCompileableFile(f->path.extension().string())) return false;
+    }
+    return true;
+}
+
+void FindImpliedLinkDependencies(std::unordered_map<std::string, Component *> &components) {
+    ComponentGraph cg = BuildComponentGraph(components);
+    const std::vector<Component *> &comps = cg.components;
+    // What a dependency brings along is what is reachable over public links; header-only components link everything
+    // as INTERFACE, which is public too.
+    std::vector<bool> headerOnly(comps.size());
+    std::vector<std::pair<size_t, size_t>> publicEdges;
+    for (size_t n = 0; n < comps.size(); n++) {
+        headerOnly[n] = IsHeaderOnly(*comps[n]);
+        for (auto &d : comps[n]->pubDeps) {
+            if (cg.index.count(d)) publicEdges.push_back(std::make_pair(n, cg.index[d]));
+        }
+        if (headerOnly[n]) {
+            for (auto &d : comps[n]->privDeps) {
+                if (cg.index.count(d)) publicEdges.push_back(std::make_pair(n, cg.index[d]));
+            }
+        }
+    }
+    Condensation all = Condense(cg.graph);
+    Condensation pub = Condense(MakeDigraph(comps.size(), std::move(publicEdges)));
+
+    std::vector<std::vector<size_t>> deps(comps.size());
+    for (size_t n = 0; n < comps.size(); n++) {
+        comps[n]->impliedDeps.clear();
+        for (const size_t *d = cg.graph.begin(n); d != cg.graph.end(n); ++d) {
+            if (all.componentOf[*d] != all.componentOf[n]) deps[n].push_back(*d);
+        }
+    }
+    auto isPublic = [&](size_t n, size_t d) { return headerOnly[n] || comps[n]->pubDeps.count(comps[d]) > 0; };
+    std::vector<std::vector<std::pair<Component *, Component *>>> found(WorkerCount());
+    ForEachReachabilityBlock(pub, [&](size_t first, size_t last, const std::vector<uint64_t>& reach, size_t words, size_t worker) {
+        for (size_t n = 0; n < comps.size(); n++) {
+            for (auto &d : deps[n]) {
+                const size_t target = pub.componentOf[d];
+                if (target < first || target >= last) continue;
+                const uint64_t bit = uint64_t(1) << ((target - first) % 64);
+                for (auto &e : deps[n]) {
+                    const size_t via = pub.componentOf[e];
+                    if (via < first || via == target || (isPublic(n, d) && !isPublic(n, e))) continue;
+                    if (reach[(via - first) * words + (target - first) / 64] & bit) {
+                        found[worker].push_back(std::make_pair(comps[n], comps[d]));
+                        break;
+                    }
+                }
+            }
+        }
+    });
+    for (auto &f : found) {
+        for (auto &p : f) {
+            p.first->impliedDeps.insert(p.second);
+        }
+    }
+}
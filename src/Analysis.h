@@ -18,6 +18,7 @@
 #define __DEP_CHECKER__ANALYSIS_H
 
 #include "Component.h"
+#include "Graph.h"
 
 void FindCircularDependencies(std::unordered_map<std::string, Component *>& components);
 
@@ -32,6 +33,128 @@ void MapIncludesToDependencies(std::unordered_map<std::string, std::string> &inc
 
 void PropagateExternalIncludes(std::unordered_map<std::string, File>& files);
 
+// The file an include statement in from refers to, or NULL if it is unknown or ambiguous.
+File *ResolveInclude(std::unordered_map<std::string, File>& files,
+                     const std::unordered_map<std::string, std::string> &includeLookup,
+                     const File &from, const std::string &include, bool withPointyBrackets);
+
+// All files that directly or indirectly include one of the roots, including the roots themselves.
+std::unordered_set<File *> CollectTransitiveIncluders(const std::vector<File *> &roots);
+
+// The include graph between files, with files[n] being node n of graph.
+struct FileGraph {
+    std::vector<File *> files;
+    std::unordered_map<File *, size_t> index;
+    Digraph graph;
+};
+
+FileGraph BuildFileGraph(std::unordered_map<std::string, File>& files);
+
+// The dependency graph between components, with components sorted by path.
+struct ComponentGraph {
+    std::vector<Component *> components;
+    std::unordered_map<Component *, size_t> index;
+    Digraph graph;
+};
+
+ComponentGraph BuildComponentGraph(std::unordered_map<std::string, Component *> &components);
+
+// Sets includeCount (the amount of never-included files that transitively include the file) and
+// transitiveLoc (the lines of code it transitively includes) on every file.
+void CalculateIncludeSizes(std::unordered_map<std::string, File>& files);
+
+// An include of target in file that can be removed, because target is already included through via.
+struct RedundantInclude {
+    File *file;
+    File *target;
+    File *via;
+};
+
+std::vector<RedundantInclude> FindRedundantIncludes(std::unordered_map<std::string, File>& files);
+
+// A header that is the only way in to the files it dominates, summed over all roots analyzed.
+struct GatewayHeader {
+    File *file;
+    uint64_t dominatedLoc;
+    uint64_t dominatedFiles;
+    size_t roots;
+};
+
+// Finds the headers that dominate other files in the include graph reachable from each root,
+// largest dominated line count first.
+std::vector<GatewayHeader> FindGatewayHeaders(std::unordered_map<std::string, File>& files, const std::vector<File *>& roots);
+
+// The component graph condensed into groups of components that depend on each other, levelized
+// for building in parallel. Groups are ordered so that dependencies come before their users.
+struct BuildLevels {
+    std::vector<std::vector<Component *>> groups;
+    std::vector<size_t> level;
+    std::vector<size_t> weight;
+    size_t levelCount;
+    // The heaviest chain of groups that has to be built one after another, from user to dependency.
+    std::vector<size_t> criticalPath;
+    size_t criticalWeight;
+    // For each group on the critical path, how much shorter it gets if that group costs nothing; largest first.
+    std::vector<std::pair<size_t, size_t>> splitGains;
+};
+
+BuildLevels CalculateBuildLevels(std::unordered_map<std::string, Component *> &components, bool weighByCompileUnits);
+
+// A file that changes often and makes many compile units rebuild when it does.
+struct Hotspot {
+    File *file;
+    size_t changes;
+    // Compile units and their lines of code rebuilt for every change of the file, including itself.
+    size_t compileUnits;
+    uint64_t compileLoc;
+    double rebuildsPerMonth;
+};
+
+// Ranks the changed files by changes per month times the compile units that include them, highest first.
+std::vector<Hotspot> FindHotspots(std::unordered_map<std::string, File>& files,
+                                  const std::unordered_map<File *, size_t>& changes, double months);
+
+// A split of one component into parts of about equal LOC with as few includes between them as possible.
+struct SplitSuggestion {
+    // Files of every part, sorted by path.
+    std::vector<std::vector<File *>> parts;
+    std::vector<size_t> partLoc;
+    // crossIncludes[a][b] is the number of includes from part a to part b.
+    std::vector<std::vector<size_t>> crossIncludes;
+    size_t internalIncludes;
+};
+
+SplitSuggestion SuggestSplit(const Component &component, size_t parts);
+
+// The component a small component is most tightly coupled to, by includes in either direction.
+struct MergeSuggestion {
+    Component *component;
+    Component *partner;
+    size_t includes;
+    // Whether merging them would create a cycle, because they also depend on each other through a third component.
+    bool createsCycle;
+};
+
+// Merge suggestions for the given components, skipping those that share no includes with any other.
+std::vector<MergeSuggestion> SuggestMerges(const std::vector<Component *> &candidates);
+
+// The headers worth precompiling for a component: those included by at least half of its compile units, ranked
+// by compile units times their own lines plus the lines they pull in, within a budget of lines. Headers reached
+// through an already selected header are left out. Angle bracket includes from outside the project count as
+// externalHeaderLoc lines each. Headers of the component are given relative to its root, those of other
+// components as the sources include them, and external ones in angle brackets.
+std::vector<std::string> SelectPrecompiledHeaders(const Component &component, uint64_t budget, uint64_t externalHeaderLoc);
+
+// The compile units of a component in batches of at most batchSize for a unity build. Units that include mostly
+// the same files end up together, so that every batch parses its shared headers once. Batches and their units are
+// in a stable order.
+std::vector<std::vector<File *>> GroupUnityBatches(const Component &component, size_t batchSize);
+
+// Sets impliedDeps on every component: the dependencies it need not link to, because another of its dependencies
+// already brings them along through public dependencies. A public dependency is only implied by another public
+// one. Dependencies in a cycle with the component are never implied, and two dependencies never imply each other.
+void FindImpliedLinkDependencies(std::unordered_map<std::string, Component *> &components);
+
 #endif
 
 
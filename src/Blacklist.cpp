@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Blacklist.h"
+#include <algorithm>
+
+static const size_t maxGlobStates = 4096;
+
+BlacklistMatcher::BlacklistMatcher(const std::unordered_set<std::string>& entries)
+: trie(1)
+{
+    for (auto& entry : entries) {
+        if (entry.find_first_of("*?") != std::string::npos) {
+            globStarts.push_back(globSteps.size());
+            for (size_t i = 0; i < entry.size(); i++) {
+                if (entry.compare(i, 3, "**/") == 0) {
+                    globSteps.push_back({ GlobStep::AnyDirectories, 0 });
+                    i += 2;
+                } else if (entry.compare(i, 2, "**") == 0 && i + 2 == entry.size()) {
+                    globSteps.push_back({ GlobStep::AnyPath, 0 });
+                    i++;
+                } else if (entry[i] == '*') {
+                    globSteps.push_back({ GlobStep::AnyRun, 0 });
+                } else if (entry[i] == '?') {
+                    globSteps.push_back({ GlobStep::AnyChar, 0 });
+                } else {
+                    globSteps.push_back({ GlobStep::Char, entry[i] });
+                }
+            }
+            globSteps.push_back({ GlobStep::Accept, 0 });
+            continue;
+        }
+        if (entry.find('/') == std::string::npos) {
+            // Elements of an unordered_set keep their address when it grows.
+            fileNames.insert(*fileNameStorage.insert(entry).first);
+        }
+        size_t node = 0;
+        for (char c : entry) {
+            auto& children = trie[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, size_t(0)));
+            if (it != children.end() && it->first == c) {
+                node = it->second;
+            } else {
+                children.insert(it, std::make_pair(c, trie.size()));
+                node = trie.size();
+                trie.emplace_back();
+            }
+        }
+        trie[node].isEntry = true;
+    }
+    if (!globStarts.empty()) {
+        scratchSeen.assign(globSteps.size(), 0);
+        for (size_t start : globStarts) AddGlobStep(start, true);
+        for (size_t step : scratchSteps) scratchSeen[step] = 0;
+        AddGlobState(scratchSteps);
+    }
+}
+
+bool BlacklistMatcher::Matches(std::string_view path) const {
+    if (path.compare(0, 2, "./") == 0) path.remove_prefix(2);
+
+    size_t node = 0;
+    for (char c : path) {
+        auto& children = trie[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, size_t(0)));
+        if (it == children.end() || it->first != c) break;
+        node = it->second;
+        if (trie[node].isEntry) return true;
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string_view fileName = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    if (!fileNames.empty() && fileNames.count(fileName)) return true;
+
+    return !globStarts.empty() && MatchesGlob(path);
+}
+
+bool BlacklistMatcher::MatchesGlob(std::string_view path) const {
+    size_t state = 0;
+    for (char c : path) {
+        state = GlobTransition(state, static_cast<unsigned char>(c));
+        if (globStates[state].steps.empty()) return false;
+    }
+    return globStates[state].accepting;
+}
+
+// Returns the state that follows state on c, working it out the first time it is needed.
+size_t BlacklistMatcher::GlobTransition(size_t state, unsigned char c) const {
+    if (globStates[state].next[c] >= 0) return size_t(globStates[state].next[c]);
+    scratchSteps.clear();
+    for (size_t step : globStates[state].steps) {
+        const GlobStep& s = globSteps[step];
+        switch (s.kind) {
+        case GlobStep::Char:
+            if (c == static_cast<unsigned char>(s.c)) AddGlobStep(step + 1, c == '/');
+            break;
+        case GlobStep::AnyChar:
+            if (c != '/') AddGlobStep(step + 1, false);
+            break;
+        case GlobStep::AnyRun:
+            if (c != '/') AddGlobStep(step, false);
+            break;
+        case GlobStep::AnyDirectories:
+            AddGlobStep(step, c == '/');
+            break;
+        case GlobStep::AnyPath:
+            AddGlobStep(step, false);
+            break;
+        case GlobStep::Accept:
+            break;
+        }
+    }
+    for (size_t step : scratchSteps) scratchSeen[step] = 0;
+    if (globStates.size() >= maxGlobStates) {
+        // Globs that need this many states are rare; start over rather than let the cache grow without bound.
+        globStates.resize(1);
+        std::fill(std::begin(globStates[0].next), std::end(globStates[0].next), -1);
+        globStateIds.clear();
+        globStateIds.emplace(globStates[0].steps, 0);
+        return AddGlobState(scratchSteps);
+    }
+    size_t next = AddGlobState(scratchSteps);
+    globStates[state].next[c] = int32_t(next);
+    return next;
+}
+
+// Returns the state for a set of steps, adding it if it is new.
+size_t BlacklistMatcher::AddGlobState(std::vector<size_t>& steps) const {
+    std::sort(steps.begin(), steps.end());
+    auto it = globStateIds.find(steps);
+    if (it != globStateIds.end()) return it->second;
+    GlobState state;
+    state.steps = steps;
+    state.accepting = false;
+    for (size_t step : steps) {
+        if (globSteps[step].kind == GlobStep::Accept) state.accepting = true;
+    }
+    std::fill(std::begin(state.next), std::end(state.next), -1);
+    globStates.push_back(std::move(state));
+    globStateIds.emplace(steps, globStates.size() - 1);
+    return globStates.size() - 1;
+}
+
+// Adds step to scratchSteps. Steps that may match nothing also add the step after them, but "**/" only
+// does so at the start of a directory name.
+void BlacklistMatcher::AddGlobStep(size_t step, bool atNameStart) const {
+    while (!scratchSeen[step]) {
+        scratchSeen[step] = 1;
+        scratchSteps.push_back(step);
+        GlobStep::Kind kind = globSteps[step].kind;
+        if (kind != GlobStep::AnyRun && kind != GlobStep::AnyPath &&
+            (kind != GlobStep::AnyDirectories || !atNameStart)) break;
+        step++;
+    }
+}
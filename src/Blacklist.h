@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__BLACKLIST_H
+#define __DEP_CHECKER__BLACKLIST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// The blacklist entries of a configuration, compiled for checking many paths against them. An entry
+// matches a path relative to the project root that starts with it, or a file name that equals it.
+// Entries with '*' or '?' are globs that must match the whole relative path instead: '*' and '?'
+// do not cross a '/', "**/" matches any number of directories and a trailing "**" matches anything.
+// The globs run as one automaton whose deterministic states are built as paths need them and then
+// reused, so once the matcher has seen similar paths, checking one takes time proportional to its
+// length, whatever the number of entries. A matcher is meant for one thread at a time.
+class BlacklistMatcher {
+public:
+    explicit BlacklistMatcher(const std::unordered_set<std::string>& entries);
+    // fileNames points into fileNameStorage, which a copy would not share.
+    BlacklistMatcher(const BlacklistMatcher&) = delete;
+    BlacklistMatcher& operator=(const BlacklistMatcher&) = delete;
+
+    // path may start with "./", as the paths of the directory walk do.
+    bool Matches(std::string_view path) const;
+
+private:
+    bool MatchesGlob(std::string_view path) const;
+    size_t GlobTransition(size_t state, unsigned char c) const;
+    void AddGlobStep(size_t step, bool atNameStart) const;
+    size_t AddGlobState(std::vector<size_t>& steps) const;
+
+    // Prefix trie of the path entries, with the children of every node sorted by character.
+    struct TrieNode {
+        std::vector<std::pair<char, size_t>> children;
+        bool isEntry = false;
+    };
+    std::vector<TrieNode> trie;
+    // File name entries, looked up by views into fileNameStorage, so that checking a path copies nothing.
+    std::unordered_set<std::string> fileNameStorage;
+    std::unordered_set<std::string_view> fileNames;
+
+    // All globs as one automaton; every glob is a run of steps ending in an Accept step.
+    struct GlobStep {
+        enum Kind { Char, AnyChar, AnyRun, AnyDirectories, AnyPath, Accept } kind;
+        char c;
+    };
+    std::vector<GlobStep> globSteps;
+    std::vector<size_t> globStarts;
+
+    // The sets of steps the globs may be at together, each with its transitions once they were needed.
+    // State 0 holds the starts of all globs.
+    struct GlobState {
+        std::vector<size_t> steps;
+        bool accepting;
+        int32_t next[256];
+    };
+    mutable std::vector<GlobState> globStates;
+    mutable std::map<std::vector<size_t>, size_t> globStateIds;
+    // Scratch space for building a transition, kept to not allocate on every path.
+    mutable std::vector<size_t> scratchSteps;
+    mutable std::vector<char> scratchSeen;
+};
+
+#endif
+
+
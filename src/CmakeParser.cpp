@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CmakeParser.h"
+#include <algorithm>
+
+namespace {
+
+class CmakeTokenizer {
+public:
+    CmakeTokenizer(const char* data, size_t size)
+    : data(data)
+    , size(size)
+    , pos(0)
+    , line(0)
+    {
+    }
+    CmakeFile Parse() {
+        CmakeFile file;
+        while (pos < size) {
+            char c = data[pos];
+            if (c == '#') {
+                file.comments.push_back(Comment());
+            } else if (IsIdentifierStart(c)) {
+                size_t begin = pos, commandLine = line;
+                while (pos < size && IsIdentifierChar(data[pos])) pos++;
+                std::string name(data + begin, pos - begin);
+                while (pos < size && (data[pos] == ' ' || data[pos] == '\t')) pos++;
+                if (pos < size && data[pos] == '(') {
+                    pos++;
+                    CmakeCommand command = { name, {}, commandLine, begin, 0 };
+                    Arguments(command, file);
+                    command.end = pos;
+                    file.commands.push_back(std::move(command));
+                }
+            } else {
+                Advance();
+            }
+        }
+        return file;
+    }
+private:
+    static bool IsIdentifierStart(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+    static bool IsIdentifierChar(char c) {
+        return IsIdentifierStart(c) || (c >= '0' && c <= '9');
+    }
+    void Advance() {
+        if (data[pos] == '\n') line++;
+        pos++;
+    }
+    // The number of '=' of a bracket opening [==[ at pos, or -1 if there is none.
+    int BracketLevel() const {
+        if (pos >= size || data[pos] != '[') return -1;
+        size_t p = pos + 1;
+        while (p < size && data[p] == '=') p++;
+        return (p < size && data[p] == '[') ? int(p - pos - 1) : -1;
+    }
+    // Skips a bracket text starting at pos and returns its contents.
+    std::string Bracket(int level) {
+        pos += level + 2;
+        const std::string close = "]" + std::string(level, '=') + "]";
+        size_t begin = pos;
+        while (pos < size && (data[pos] != ']' || pos + close.size() > size || close.compare(0, close.size(), data + pos, close.size()) != 0)) {
+            Advance();
+        }
+        std::string contents(data + begin, pos - begin);
+        pos = std::min(size, pos + close.size());
+        return contents;
+    }
+    std::string Comment() {
+        pos++;
+        int level = BracketLevel();
+        if (level >= 0) return Bracket(level);
+        size_t begin = pos;
+        while (pos < size && data[pos] != '\n') pos++;
+        return std::string(data + begin, pos - begin);
+    }
+    void Quoted() {
+        Advance();
+        while (pos < size && data[pos] != '"') {
+            if (data[pos] == '\\' && pos + 1 < size) Advance();
+            Advance();
+        }
+        if (pos < size) pos++;
+    }
+    void Arguments(CmakeCommand& command, CmakeFile& file) {
+        size_t depth = 1;
+        while (pos < size) {
+            const char c = data[pos];
+            const size_t begin = pos, argLine = line;
+            int level;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                Advance();
+            } else if (c == '#') {
+                file.comments.push_back(Comment());
+            } else if (c == '(') {
+                depth++;
+                pos++;
+            } else if (c == ')') {
+                pos++;
+                if (--depth == 0) return;
+            } else if (c == '"') {
+                Quoted();
+                std::string spelling(data + begin, pos - begin);
+                std::string value = spelling.substr(1, spelling.size() >= 2 && spelling.back() == '"' ? spelling.size() - 2 : std::string::npos);
+                command.args.push_back(CmakeArgument{ spelling, value, argLine });
+            } else if ((level = BracketLevel()) >= 0) {
+                std::string value = Bracket(level);
+                command.args.push_back(CmakeArgument{ std::string(data + begin, pos - begin), value, argLine });
+            } else {
+                // Unquoted, which may contain escapes and, for compatibility, quoted parts.
+                while (pos < size) {
+                    const char u = data[pos];
+                    if (u == ' ' || u == '\t' || u == '\r' || u == '\n' || u == '(' || u == ')' || u == '#') break;
+                    if (u == '"') {
+                        Quoted();
+                    } else {
+                        if (u == '\\' && pos + 1 < size) Advance();
+                        Advance();
+                    }
+                }
+                std::string spelling(data + begin, pos - begin);
+                command.args.push_back(CmakeArgument{ spelling, spelling, argLine });
+            }
+        }
+    }
+
+    const char* data;
+    size_t size, pos, line;
+};
+
+}
+
+CmakeFile ParseCmake(const char* data, size_t size) {
+    return CmakeTokenizer(data, size).Parse();
+}
+
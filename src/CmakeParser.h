@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__CMAKEPARSER_H
+#define __DEP_CHECKER__CMAKEPARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct CmakeArgument {
+    // As written, including quotes or brackets.
+    std::string spelling;
+    // Without quotes or brackets. Escape sequences and variable references are left as they are.
+    std::string value;
+    size_t line;
+};
+
+// A command invocation such as add_library(...), which may span several lines.
+struct CmakeCommand {
+    std::string name;
+    std::vector<CmakeArgument> args;
+    // Line of the command name, counting from 0.
+    size_t line;
+    // Byte offsets of the command name and of the character after its closing parenthesis.
+    size_t begin, end;
+};
+
+struct CmakeFile {
+    std::vector<CmakeCommand> commands;
+    std::vector<std::string> comments;
+};
+
+// Splits the text of a CMake file into its commands and comments in a single pass. Nested parentheses, quoted
+// and bracket arguments and comments within a command are handled. A command that is not closed by the end of
+// the text ends there.
+CmakeFile ParseCmake(const char* data, size_t size);
+
+#endif
+
+
@@ -14,29 +14,34 @@
  * limitations under the License.
  */
 
+#include "Analysis.h"
 #include "CmakeRegen.h"
 #include "Component.h"
 #include "Configuration.h"
+#include "Constants.h"
 #include "Input.h"
+#include "Output.h"
 #include <list>
+#include <map>
+#include <mutex>
 #include <set>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <unordered_set>
 
-static bool FilesAreDifferent(const std::filesystem::path &a, const std::filesystem::path &b) {
-    if (std::filesystem::file_size(a) != std::filesystem::file_size(b)) {
+bool FileContentDiffers(const std::filesystem::path &path, const std::string &contents) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    // Text mode never makes the contents longer than the file on disk, so a shorter file always differs.
+    if (ec || size < contents.size()) {
         return true;
     }
-    std::ifstream as(a), bs(b);
-    std::string l1, l2;
-    while (as.good() && bs.good()) {
-        getline(as, l1);
-        getline(bs, l2);
-        if (l1 != l2) {
-            return true;
-        }
-    }
-    return !(as.eof() && bs.eof());
+    std::ifstream in(path);
+    std::string existing(size, '\0');
+    in.read(&existing[0], size);
+    existing.resize(in.gcount());
+    return existing != contents;
 }
 
 void MakeCmakeComment(std::string& cmakeComment, const std::string& contents)
@@ -55,96 +60,265 @@ void MakeCmakeComment(std::string& cmakeComment, const std::string& contents)
     }
 }
 
-void RegenerateCmakeFilesForComponent(const Configuration& config, Component *comp, bool dryRun, bool writeToStdout) {
-    if (comp->recreate || writeToStdout) {
-        std::string compname = comp->CmakeName();
-        bool isHeaderOnly = true;
-        std::set<std::string> publicDeps, privateDeps, publicIncl, privateIncl;
-        std::list<std::string> files;
-        for (auto &fp : comp->files) {
-            files.push_back(fp->path.generic_string().c_str() + compname.size() + 3);
-            std::filesystem::path p = fp->path;
-            if (fp->hasInclude) {
-                (fp->hasExternalInclude ? publicIncl : privateIncl).insert(fp->includePaths.begin(),
-                                                                           fp->includePaths.end());
-            }
-            if (IsCompileableFile(p.extension().string())) {
-                isHeaderOnly = false;
-            }
-        }
-        for (auto &d : comp->privDeps) {
-            privateDeps.insert(d->CmakeName());
-        }
-        for (auto &d : comp->pubDeps) {
-            publicDeps.insert(d->CmakeName());
+// Everything from the analysis that goes into the CMakeLists.txt of a component, apart from the component's own fields.
+struct CmakeListsInputs {
+    bool isHeaderOnly;
+    std::list<std::string> files;
+    std::set<std::string> publicDeps, privateDeps, publicIncl, privateIncl;
+    std::set<std::string> subdirectories;
+};
+
+static CmakeListsInputs CollectCmakeListsInputs(const Configuration& config, Component *comp) {
+    CmakeListsInputs in;
+    std::string compname = comp->CmakeName();
+    in.isHeaderOnly = true;
+    for (auto &fp : comp->files) {
+        in.files.push_back(fp->path.generic_string().c_str() + compname.size() + 3);
+        std::filesystem::path p = fp->path;
+        if (fp->hasInclude) {
+            (fp->hasExternalInclude ? in.publicIncl : in.privateIncl).insert(fp->includePaths.begin(),
+                                                                             fp->includePaths.end());
         }
-        files.sort();
-        if (!files.empty() && comp->type == "") {
-            comp->type = "add_library";
+        if (IsCompileableFile(p.extension().string())) {
+            in.isHeaderOnly = false;
         }
+    }
+    for (auto &d : comp->privDeps) {
+        if (config.reduceLinkLibraries && comp->impliedDeps.count(d)) continue;
+        in.privateDeps.insert(d->CmakeName());
+    }
+    for (auto &d : comp->pubDeps) {
+        if (config.reduceLinkLibraries && comp->impliedDeps.count(d)) continue;
+        in.publicDeps.insert(d->CmakeName());
+    }
+    in.files.sort();
+    if (!in.files.empty() && comp->type == "") {
+        comp->type = "add_library";
+    }
 
-        for (auto &s : publicDeps) {
-            privateDeps.erase(s);
+    for (auto &s : in.publicDeps) {
+        in.privateDeps.erase(s);
+    }
+    for (auto &s : in.publicIncl) {
+        in.privateIncl.erase(s);
+    }
+    in.subdirectories = CmakeSubdirectories(*comp);
+    return in;
+}
+
+static std::string RenderCmakeLists(const Configuration& config, Component *comp, const CmakeListsInputs& in) {
+    std::ostringstream o;
+    RegenerateCmakeHeader(o, config);
+
+    if (comp->root == ".") {
+        // Do this for the user, so that you don't get a warning on either 
+        // not doing this, or doing this in the addon file.
+        o << "cmake_minimum_required(VERSION " << config.cmakeVersion << ")\n";
+    }
+
+    if (!in.files.empty()) {
+        o << "project(" << comp->CmakeName() << ")" << "\n\n";
+    }
+
+    o << "\n";
+
+    if (!in.files.empty()) {
+        RegenerateCmakeAddTarget(o, config, *comp, in.files, in.isHeaderOnly);
+        RegenerateCmakeTargetLinkLibraries(o, in.publicDeps, in.privateDeps, in.isHeaderOnly);
+        RegenerateCmakeTargetIncludeDirectories(o, in.publicIncl, in.privateIncl, in.isHeaderOnly);
+        if (config.pchBudget > 0 && !in.isHeaderOnly) {
+            RegenerateCmakeTargetPrecompileHeaders(o, SelectPrecompiledHeaders(*comp, config.pchBudget, config.pchExternalHeaderLoc));
         }
-        for (auto &s : publicIncl) {
-            privateIncl.erase(s);
+        if (config.unityBuildBatchSize > 1 && !in.isHeaderOnly) {
+            std::vector<std::vector<std::string>> batches;
+            for (auto &batch : GroupUnityBatches(*comp, config.unityBuildBatchSize)) {
+                batches.emplace_back();
+                for (auto &f : batch) {
+                    batches.back().push_back(f->path.lexically_relative(comp->root).generic_string());
+                }
+            }
+            RegenerateCmakeUnityBuild(o, batches);
         }
+        RegenerateCmakeAddDependencies(o, *comp);
+    }
 
-        {
-            std::ofstream out;
-            if (writeToStdout) {
-                std::cout << "######## Start of " << comp->root.generic_string() << "/CMakeLists.txt\n";
-            } else {
-                out.open(comp->root / "CMakeLists.txt.generated");
-            }
-            std::ostream& o = writeToStdout ? std::cout : out;
+    if (comp->hasAddonCmake) {
+        o << "include(CMakeAddon.txt)" << "\n";
+    }
 
-            RegenerateCmakeHeader(o, config);
+    if (config.reuseCustomSections) {
+        o << comp->additionalCmakeDeclarations;
+    }
 
-            if (comp->root == ".") {
-                // Do this for the user, so that you don't get a warning on either 
-                // not doing this, or doing this in the addon file.
-                o << "cmake_minimum_required(VERSION " << config.cmakeVersion << ")\n";
-            }
+    for (auto &subdir : in.subdirectories) {
+        o << "add_subdirectory(" << subdir << ")\n";
+    }
+    return o.str();
+}
 
-            if (!files.empty()) {
-                o << "project(" << compname << ")" << "\n\n";
-            }
+std::string RenderCmakeListsForComponent(const Configuration& config, Component *comp) {
+    return RenderCmakeLists(config, comp, CollectCmakeListsInputs(config, comp));
+}
 
-            o << "\n";
+// 64-bit FNV-1a, fed field by field. Every field ends in a separator, so that moving text from one field to the
+// next changes the hash.
+struct FingerprintHash {
+    uint64_t value = 14695981039346656037ULL;
+    FingerprintHash& operator<<(const std::string& s) {
+        for (char c : s) Add(static_cast<unsigned char>(c));
+        Add(0);
+        return *this;
+    }
+    FingerprintHash& operator<<(uint64_t n) {
+        return *this << std::to_string(n);
+    }
+    template <typename Container>
+    FingerprintHash& All(const Container& strings) {
+        *this << uint64_t(strings.size());
+        for (auto &s : strings) *this << s;
+        return *this;
+    }
+    void Add(unsigned char c) {
+        value = (value ^ c) * 1099511628211ULL;
+    }
+};
 
-            if (!files.empty()) {
-                RegenerateCmakeAddTarget(o, config, *comp, files, isHeaderOnly);
-                RegenerateCmakeTargetLinkLibraries(o, publicDeps, privateDeps, isHeaderOnly);
-                RegenerateCmakeTargetIncludeDirectories(o, publicIncl, privateIncl, isHeaderOnly);
-                RegenerateCmakeAddDependencies(o, *comp);
-            }
+// Raise this whenever a change to the generator changes the CMakeLists.txt it renders for the same inputs, so
+// that files generated by an older version are not skipped as up to date.
+static const uint64_t renderFormatVersion = 1;
 
-            if (comp->hasAddonCmake) {
-                o << "include(CMakeAddon.txt)" << "\n";
-            }
+static void HashConfiguration(FingerprintHash& h, const Configuration& config) {
+    std::set<std::string> aliases(config.addLibraryAliases.begin(), config.addLibraryAliases.end());
+    h << std::string(CURRENT_VERSION) << renderFormatVersion;
+    h << config.companyName << config.licenseString << config.regenTag << config.cmakeVersion;
+    h.All(aliases);
+    h << uint64_t(config.reuseCustomSections) << uint64_t(config.reduceLinkLibraries);
+    h << config.pchBudget << config.pchExternalHeaderLoc << config.unityBuildBatchSize;
+}
 
-            if (config.reuseCustomSections) {
-                o << comp->additionalCmakeDeclarations;
-            }
+// Precompiled headers and unity batches depend on the files a component's compile units include, also in other
+// components, so those go into the fingerprint when either is enabled.
+static void HashIncludeClosure(FingerprintHash& h, const Component& comp) {
+    std::unordered_set<const File *> reached;
+    std::vector<const File *> todo;
+    for (auto &f : comp.files) {
+        if (reached.insert(f).second) todo.push_back(f);
+    }
+    while (!todo.empty()) {
+        const File *f = todo.back();
+        todo.pop_back();
+        for (auto &d : f->dependencies) {
+            if (reached.insert(d).second) todo.push_back(d);
+        }
+    }
+    std::vector<std::string> lines;
+    for (auto &f : reached) {
+        std::string line = f->path.generic_string() + " " + std::to_string(f->loc) + " " + std::to_string(f->transitiveLoc);
+        std::set<std::string> deps;
+        for (auto &d : f->dependencies) deps.insert(d->path.generic_string());
+        for (auto &d : deps) line += " " + d;
+        for (auto &i : f->rawIncludes) line += (i.second ? " <" : " \"") + i.first;
+        lines.push_back(line);
+    }
+    std::sort(lines.begin(), lines.end());
+    h.All(lines);
+}
+
+static uint64_t Fingerprint(const Configuration& config, const Component& comp, const CmakeListsInputs& in) {
+    FingerprintHash h;
+    HashConfiguration(h, config);
+    h << comp.root.generic_string() << comp.CmakeName() << comp.type << uint64_t(in.isHeaderOnly);
+    h.All(in.files).All(in.publicDeps).All(in.privateDeps).All(in.publicIncl).All(in.privateIncl).All(in.subdirectories);
+    h.All(comp.buildAfters);
+    h << uint64_t(comp.hasAddonCmake) << comp.additionalTargetParameters << comp.additionalCmakeDeclarations;
+    if ((config.pchBudget > 0 || config.unityBuildBatchSize > 1) && !in.isHeaderOnly) {
+        HashIncludeClosure(h, comp);
+    }
+    return h.value;
+}
+
+uint64_t CmakeListsFingerprint(const Configuration& config, Component *comp) {
+    return Fingerprint(config, *comp, CollectCmakeListsInputs(config, comp));
+}
+
+static bool FileMatchesRecord(const std::filesystem::path& path, const RegenRecord& record) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec || size != record.size) return false;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return !ec && int64_t(time.time_since_epoch().count()) == record.modified;
+}
+
+static void UpdateRecord(const std::filesystem::path& path, uint64_t fingerprint, RegenRecord& record) {
+    std::error_code ec;
+    record.fingerprint = fingerprint;
+    record.size = std::filesystem::file_size(path, ec);
+    record.modified = ec ? 0 : int64_t(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+}
 
-            RegenerateCmakeAddSubdirectory(o, *comp);
+bool RegenerateCmakeFilesForComponent(const Configuration& config, Component *comp, bool dryRun, bool writeToStdout,
+                                      RegenRecord *record) {
+    if (!comp->recreate && !writeToStdout) {
+        return false;
+    }
+    const CmakeListsInputs inputs = CollectCmakeListsInputs(config, comp);
+    const std::filesystem::path path = comp->root / "CMakeLists.txt";
+    uint64_t fingerprint = 0;
+    if (record && !writeToStdout) {
+        // Nothing that goes into the file changed since it was last generated, and nobody touched the file since.
+        fingerprint = Fingerprint(config, *comp, inputs);
+        if (record->fingerprint == fingerprint && FileMatchesRecord(path, *record)) {
+            return false;
         }
-        if (writeToStdout) {
-            std::cout << "######## End of " << comp->root.generic_string() << "/CMakeLists.txt\n";
-            // No actual file written.
-        } else if (dryRun) {
-            if (FilesAreDifferent(comp->root / "CMakeLists.txt.generated", comp->root / "CMakeLists.txt")) {
-                std::cout << "Difference detected at " << comp->root << "\n";
-            }
-            std::filesystem::remove(comp->root / "CMakeLists.txt.generated");
-        } else {
-            if (FilesAreDifferent(comp->root / "CMakeLists.txt.generated", comp->root / "CMakeLists.txt")) {
-                std::filesystem::rename(comp->root / "CMakeLists.txt.generated", comp->root / "CMakeLists.txt");
-            } else {
-                std::filesystem::remove(comp->root / "CMakeLists.txt.generated");
-            }
+    }
+    const std::string contents = RenderCmakeLists(config, comp, inputs);
+    if (writeToStdout) {
+        std::cout << "######## Start of " << comp->root.generic_string() << "/CMakeLists.txt\n";
+        std::cout << contents;
+        std::cout << "######## End of " << comp->root.generic_string() << "/CMakeLists.txt\n";
+        // No actual file written.
+        return false;
+    }
+    if (!FileContentDiffers(path, contents)) {
+        if (record && !dryRun) UpdateRecord(path, fingerprint, *record);
+        return false;
+    }
+    if (!dryRun) {
+        std::error_code ec;
+        if (!ReplaceFile(path, comp->root / "CMakeLists.txt.generated", contents, false, ec)) {
+            // Leave the record alone, so that the next run tries again.
+            static std::mutex reportMutex;
+            std::lock_guard<std::mutex> lock(reportMutex);
+            std::cout << "Cannot write " << path.generic_string() << ": " << ec.message() << "\n";
+            return false;
         }
+        if (record) UpdateRecord(path, fingerprint, *record);
+    }
+    return true;
+}
+
+static const char regenRecordHeader[] = "cpp-dependencies regen 1";
+
+bool ReadRegenRecords(std::istream& in, RegenRecords& records) {
+    std::string line;
+    if (!std::getline(in, line) || line != regenRecordHeader) return false;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        RegenRecord record;
+        std::string root;
+        if (!(fields >> std::hex >> record.fingerprint >> std::dec >> record.size >> record.modified)) return false;
+        fields.get();
+        std::getline(fields, root);
+        records[root] = record;
+    }
+    return true;
+}
+
+void WriteRegenRecords(std::ostream& out, const RegenRecords& records) {
+    std::map<std::string, RegenRecord> sorted(records.begin(), records.end());
+    out << regenRecordHeader << "\n";
+    for (auto &r : sorted) {
+        out << std::hex << r.second.fingerprint << std::dec << " " << r.second.size << " " << r.second.modified << " " << r.first << "\n";
     }
 }
 
@@ -171,21 +345,24 @@ void RegenerateCmakeAddDependencies(std::ostream& o, const Component& comp) {
     }
 }
 
-void RegenerateCmakeAddSubdirectory(std::ostream& o,
-                                    const Component& comp)
-{
-    // Temporary uses a set to sort subdirectories
+std::set<std::string> CmakeSubdirectories(const Component& comp) {
     std::set<std::string> subdirs;
-    std::filesystem::directory_iterator it(comp.root), end;
-    for (; it != end; ++it) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(comp.root, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
         if (std::filesystem::is_regular_file(it->path() / "CMakeLists.txt")) {
             subdirs.insert(it->path().filename().generic_string());
         }
     }
-    for (auto subdir : subdirs) {
+    return subdirs;
+}
+
+void RegenerateCmakeAddSubdirectory(std::ostream& o,
+                                    const Component& comp)
+{
+    for (auto subdir : CmakeSubdirectories(comp)) {
         o << "add_subdirectory(" << subdir << ")\n";
     }
-        
 }
 
 void RegenerateCmakeAddTarget(std::ostream& o,
@@ -266,3 +443,30 @@ void RegenerateCmakeTargetLinkLibraries(std::ostream& o,
         o << ")\n\n";
     }
 }
+
+void RegenerateCmakeTargetPrecompileHeaders(std::ostream& o,
+                                            const std::vector<std::string>& headers) {
+    if (!headers.empty()) {
+        o << "target_precompile_headers(${PROJECT_NAME}\n";
+        o << "  PRIVATE\n";
+        for (auto &h : headers) {
+            o << "    " << h << "\n";
+        }
+        o << ")\n\n";
+    }
+}
+
+void RegenerateCmakeUnityBuild(std::ostream& o,
+                               const std::vector<std::vector<std::string>>& batches) {
+    if (!batches.empty()) {
+        o << "set_target_properties(${PROJECT_NAME} PROPERTIES UNITY_BUILD ON UNITY_BUILD_MODE GROUP)\n";
+        for (size_t n = 0; n < batches.size(); n++) {
+            o << "set_source_files_properties(";
+            for (auto &f : batches[n]) {
+                o << f << " ";
+            }
+            o << "PROPERTIES UNITY_GROUP unity_" << n << ")\n";
+        }
+        o << "\n";
+    }
+}
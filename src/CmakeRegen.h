@@ -17,24 +17,62 @@
 #ifndef __DEP_CHECKER__CMAKEREGEN_H
 #define __DEP_CHECKER__CMAKEREGEN_H
 
+#include <cstdint>
+#include <filesystem>
+#include <istream>
 #include <list>
 #include <ostream>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 struct Component;
 struct Configuration;
 
-void RegenerateCmakeFilesForComponent(const Configuration& config,
+// The contents of the CMakeLists.txt for a component.
+std::string RenderCmakeListsForComponent(const Configuration& config,
+                                         Component *comp);
+
+// What a component's CMakeLists.txt was last generated from, and the size and modification time it had then.
+struct RegenRecord {
+    uint64_t fingerprint;
+    uintmax_t size;
+    int64_t modified;
+};
+
+// Regen records by component root, kept between runs.
+typedef std::unordered_map<std::string, RegenRecord> RegenRecords;
+
+bool ReadRegenRecords(std::istream& in, RegenRecords& records);
+void WriteRegenRecords(std::ostream& out, const RegenRecords& records);
+
+// A hash of everything that goes into the CMakeLists.txt of a component, including the configuration.
+uint64_t CmakeListsFingerprint(const Configuration& config,
+                               Component *comp);
+
+// Regenerates the CMakeLists.txt of a component marked for recreation, and returns whether its contents changed (or
+// would change, in a dry run). The file is only written when they did. With a record, the component is skipped
+// without rendering if its fingerprint and file match the record, and the record is updated after a real run.
+// A file that cannot be written is reported and left as it was, together with its record, and counts as unchanged.
+// Safe to call for several components at once.
+bool RegenerateCmakeFilesForComponent(const Configuration& config,
                                       Component *comp,
                                       bool dryRun, 
-                                      bool writeToStdout);
+                                      bool writeToStdout,
+                                      RegenRecord *record = NULL);
+
+// Whether the file at path does not hold exactly contents, reading it with a single read.
+bool FileContentDiffers(const std::filesystem::path& path,
+                        const std::string& contents);
 
 void MakeCmakeComment(std::string& cmakeComment,
                       const std::string& contents);
 
 void RegenerateCmakeAddDependencies(std::ostream& o,
                                     const Component& comp);
+// The subdirectories of a component that have a CMakeLists.txt, sorted.
+std::set<std::string> CmakeSubdirectories(const Component& comp);
 void RegenerateCmakeAddSubdirectory(std::ostream& o,
                                     const Component& comp);
 void RegenerateCmakeAddTarget(std::ostream& o,
@@ -47,6 +85,10 @@ void RegenerateCmakeTargetIncludeDirectories(std::ostream& o,
                                              const std::set<std::string>& publicIncl,
                                              const std::set<std::string>& privateIncl,
                                              bool isHeaderOnly);
+void RegenerateCmakeTargetPrecompileHeaders(std::ostream& o,
+                                            const std::vector<std::string>& headers);
+void RegenerateCmakeUnityBuild(std::ostream& o,
+                               const std::vector<std::vector<std::string>>& batches);
 void RegenerateCmakeTargetLinkLibraries(std::ostream& o,
                                         const std::set<std::string>& publicDeps,
                                         const std::set<std::string>& privateDeps,
@@ -39,6 +39,7 @@ struct File {
     , component(NULL)
     , loc(0)
     , includeCount(0)
+    , transitiveLoc(0)
     , hasExternalInclude(false)
     , hasInclude(false)
     {
@@ -50,10 +51,13 @@ struct File {
     std::filesystem::path path;
     std::map<std::string, bool> rawIncludes;
     std::unordered_set<File *> dependencies;
+    // includedBy is the reverse of dependencies: the files that include this one
+    std::unordered_set<File *> includedBy;
     std::unordered_set<std::string> includePaths;
     Component *component;
     size_t loc;
     size_t includeCount;
+    size_t transitiveLoc;
     bool hasExternalInclude;
     bool hasInclude;
 };
@@ -76,7 +80,11 @@ struct Component {
     std::unordered_set<Component *> pubLinks;
     std::unordered_set<Component *> privLinks;
     std::unordered_set<Component *> circulars;
+    // includeReasons are the (includer, included) file pairs behind each dependency
+    std::unordered_map<Component *, std::vector<std::pair<File *, File *>>> includeReasons;
     std::set<std::string> buildAfters;
+    // impliedDeps are the deps that another dep already brings along through its public dependencies
+    std::unordered_set<Component *> impliedDeps;
     std::unordered_set<File *> files;
     size_t loc() const {
         size_t l = 0;
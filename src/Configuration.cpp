@@ -68,7 +68,15 @@ Configuration::Configuration()
 , componentLocLowerLimit(200)
 , componentLocUpperLimit(20000)
 , fileLocUpperLimit(2000)
+, budgetImpactTolerance(5)
+, budgetImpactSlack(10000)
+, budgetFanOutTolerance(0)
+, pchBudget(0)
+, pchExternalHeaderLoc(5000)
+, unityBuildBatchSize(0)
 , reuseCustomSections(false)
+, reduceLinkLibraries(false)
+, includeCountLabels(false)
 {
   addLibraryAliases.insert("add_library");
   addExecutableAliases.insert("add_executable");
@@ -107,11 +115,19 @@ void Configuration::read(std::istream& in)
     else if (name == "componentLocLowerLimit") { componentLocLowerLimit = atol(value.c_str()); }
     else if (name == "componentLocUpperLimit") { componentLocUpperLimit = atol(value.c_str()); }
     else if (name == "fileLocUpperLimit") { fileLocUpperLimit = atol(value.c_str()); }
+    else if (name == "budgetImpactTolerance") { budgetImpactTolerance = atol(value.c_str()); }
+    else if (name == "budgetImpactSlack") { budgetImpactSlack = atol(value.c_str()); }
+    else if (name == "budgetFanOutTolerance") { budgetFanOutTolerance = atol(value.c_str()); }
+    else if (name == "pchBudget") { pchBudget = atol(value.c_str()); }
+    else if (name == "pchExternalHeaderLoc") { pchExternalHeaderLoc = atol(value.c_str()); }
+    else if (name == "unityBuildBatchSize") { unityBuildBatchSize = atol(value.c_str()); }
     else if (name == "addLibraryAlias") { ReadSet(addLibraryAliases, in); }
     else if (name == "addExecutableAlias") { ReadSet(addExecutableAliases, in); }
     else if (name == "addIgnores") { ReadSet(addIgnores, in); }
     else if (name == "licenseString") { licenseString = ReadMultilineString(in); }
     else if (name == "reuseCustomSections") { reuseCustomSections = (value == "true"); }
+    else if (name == "reduceLinkLibraries") { reduceLinkLibraries = (value == "true"); }
+    else if (name == "includeCountLabels") { includeCountLabels = (value == "true"); }
     else if (name == "blacklist") { ReadSet(blacklist, in); }
     else {
       std::cout << "Ignoring unknown tag in configuration file: " << name << "\n";
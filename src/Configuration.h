@@ -39,7 +39,15 @@ struct Configuration {
   size_t componentLocLowerLimit;
   size_t componentLocUpperLimit;
   size_t fileLocUpperLimit;
+  size_t budgetImpactTolerance;
+  size_t budgetImpactSlack;
+  size_t budgetFanOutTolerance;
+  size_t pchBudget;
+  size_t pchExternalHeaderLoc;
+  size_t unityBuildBatchSize;
   bool reuseCustomSections;
+  bool reduceLinkLibraries;
+  bool includeCountLabels;
 };
 
 #endif
@@ -19,6 +19,9 @@
 
 #define CONFIG_FILE "config-cpp-dependencies.txt"
 
+// What --regen generated every CMakeLists.txt from, so that unchanged components can be skipped.
+#define REGEN_RECORD_FILE ".cpp-dependencies-regen"
+
 #define CURRENT_VERSION "2"
 
 #endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GitLog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+static const char cacheHeader[] = "cpp-dependencies commit log 1";
+
+std::vector<CommitFiles> ParseGitLog(std::istream& in) {
+    std::vector<CommitFiles> commits;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.compare(0, 7, "commit ") == 0) {
+            std::istringstream header(line.substr(7));
+            CommitFiles commit;
+            commit.time = 0;
+            header >> commit.id >> commit.time;
+            commits.push_back(commit);
+        } else if (!line.empty() && !commits.empty()) {
+            commits.back().files.push_back(line);
+        }
+    }
+    return commits;
+}
+
+bool ReadCommitLog(std::istream& in, CommitLog& log) {
+    std::string header, since;
+    if (!std::getline(in, header) || header != cacheHeader) return false;
+    if (!std::getline(in, since) || since.compare(0, 6, "since ") != 0) return false;
+    log.since = strtoll(since.c_str() + 6, NULL, 10);
+    log.commits = ParseGitLog(in);
+    return true;
+}
+
+void WriteCommitLog(std::ostream& out, const CommitLog& log) {
+    out << cacheHeader << "\nsince " << log.since << "\n";
+    for (auto& c : log.commits) {
+        out << "commit " << c.id << " " << c.time << "\n\n";
+        for (auto& f : c.files) {
+            out << f << "\n";
+        }
+        out << "\n";
+    }
+}
+
+static std::string Quoted(const std::string& arg) {
+#ifdef _WIN32
+    return "\"" + arg + "\"";
+#else
+    std::string quoted = "'";
+    for (auto& c : arg) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+// Runs a git command in root, returning whether it succeeded.
+static bool RunGit(const std::filesystem::path& root, const std::string& args, std::string& output) {
+    std::string command = "git -C " + Quoted(root.string()) + " -c core.quotepath=off " + args;
+#ifdef _WIN32
+    command += " 2>NUL";
+#else
+    command += " 2>/dev/null";
+#endif
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) return false;
+    output.clear();
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, count);
+    }
+    return pclose(pipe) == 0;
+}
+
+CommitLog ReadGitHistory(const std::filesystem::path& root, int64_t since, const std::filesystem::path& cacheFile) {
+    CommitLog cached;
+    bool useCache = false;
+    {
+        std::ifstream in(cacheFile);
+        useCache = in && ReadCommitLog(in, cached) && cached.since <= since && !cached.commits.empty();
+    }
+    std::string head;
+    if (!RunGit(root, "rev-parse HEAD", head)) return CommitLog{ since, {} };
+    head = head.substr(0, head.find_first_of("\r\n"));
+
+    std::string range = "HEAD", ignored;
+    if (useCache && cached.commits.front().id != head) {
+        // Only continue from the cache if history was not rewritten since.
+        if (RunGit(root, "merge-base --is-ancestor " + cached.commits.front().id + " HEAD", ignored)) {
+            range = cached.commits.front().id + "..HEAD";
+        } else {
+            useCache = false;
+        }
+    }
+    CommitLog log;
+    log.since = useCache ? cached.since : since;
+    if (!useCache || cached.commits.front().id != head) {
+        std::string output;
+        std::string args = "log --no-merges --no-renames --relative --format=\"commit %H %ct\" --name-only";
+        if (log.since > 0) args += " --since=" + std::to_string(log.since);
+        if (!RunGit(root, args + " " + range, output)) return CommitLog{ since, {} };
+        std::istringstream in(output);
+        log.commits = ParseGitLog(in);
+    }
+    if (useCache) {
+        log.commits.insert(log.commits.end(), cached.commits.begin(), cached.commits.end());
+    }
+    // Commits older than the requested window are dropped from the cache too, so that it does not keep growing.
+    log.since = since;
+    log.commits.erase(std::remove_if(log.commits.begin(), log.commits.end(), [since](const CommitFiles& c) { return c.time <= since; }),
+                      log.commits.end());
+    {
+        std::ofstream out(cacheFile);
+        WriteCommitLog(out, log);
+    }
+    return log;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__GITLOG_H
+#define __DEP_CHECKER__GITLOG_H
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// One commit with the files it changed, relative to the analyzed directory.
+struct CommitFiles {
+    std::string id;
+    int64_t time;
+    std::vector<std::string> files;
+};
+
+// A list of commits, newest first, holding every commit made after since.
+struct CommitLog {
+    int64_t since;
+    std::vector<CommitFiles> commits;
+};
+
+// Reads the output of git log --format="commit %H %ct" --name-only.
+std::vector<CommitFiles> ParseGitLog(std::istream& in);
+
+bool ReadCommitLog(std::istream& in, CommitLog& log);
+void WriteCommitLog(std::ostream& out, const CommitLog& log);
+
+// Commits made after since to the git repository that holds root, touching files below root.
+// The commits are cached in cacheFile; if that holds the same history, only the commits
+// after the newest cached one are read from git. The cache keeps only the requested window.
+CommitLog ReadGitHistory(const std::filesystem::path& root, int64_t since, const std::filesystem::path& cacheFile);
+
+#endif
+
+
@@ -0,0 +1,570 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GitRepository.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef WITH_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+// Delta bases are kept per pack up to this many bytes, objects by name up to cacheLimit.
+static const size_t baseCacheLimit = 32 * 1024 * 1024;
+
+std::string ToHex(const ObjectId& id) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (auto& b : id) {
+        hex += digits[b >> 4];
+        hex += digits[b & 15];
+    }
+    return hex;
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool IsHex(const std::string& s) {
+    return std::all_of(s.begin(), s.end(), [](char c) { return HexValue(c) >= 0; });
+}
+
+bool FromHex(const std::string& hex, ObjectId& id) {
+    if (hex.size() < 40 || !IsHex(hex.substr(0, 40))) return false;
+    for (size_t n = 0; n < 20; n++) {
+        id[n] = uint8_t(HexValue(hex[2 * n]) * 16 + HexValue(hex[2 * n + 1]));
+    }
+    return true;
+}
+
+static std::string ReadSmallFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string s = content.str();
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r' || s.back() == ' ')) s.pop_back();
+    return s;
+}
+
+// A whole file in memory, mapped where possible.
+struct MappedFile {
+    const uint8_t* data = NULL;
+    size_t size = 0;
+#ifdef WITH_MMAP
+    ~MappedFile() {
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+    }
+    bool Open(const std::filesystem::path& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        size = std::filesystem::file_size(path);
+        void* p = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (p == MAP_FAILED) return false;
+        data = static_cast<const uint8_t*>(p);
+        return true;
+    }
+#else
+    std::string buffer;
+    bool Open(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        buffer.resize(std::filesystem::file_size(path));
+        in.read(&buffer[0], buffer.size());
+        data = reinterpret_cast<const uint8_t*>(buffer.data());
+        size = buffer.size();
+        return true;
+    }
+#endif
+};
+
+static uint32_t BigEndian32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// A packfile with its version 2 index.
+struct PackFile {
+    MappedFile index, pack;
+    uint32_t count = 0;
+    const uint8_t *names = NULL, *offsets = NULL, *largeOffsets = NULL;
+    std::unordered_map<uint64_t, std::pair<ObjectType, std::string>> baseCache;
+    size_t baseCacheSize = 0;
+
+    bool Open(const std::filesystem::path& indexPath) {
+        std::filesystem::path packPath = indexPath;
+        packPath.replace_extension(".pack");
+        if (!index.Open(indexPath) || !pack.Open(packPath)) return false;
+        static const uint8_t magic[] = { 0xff, 't', 'O', 'c', 0, 0, 0, 2 };
+        if (index.size < 8 + 256 * 4 || memcmp(index.data, magic, 8) != 0) return false;
+        count = BigEndian32(index.data + 8 + 255 * 4);
+        names = index.data + 8 + 256 * 4;
+        offsets = names + size_t(count) * (20 + 4);
+        largeOffsets = offsets + size_t(count) * 4;
+        return size_t(largeOffsets - index.data) <= index.size;
+    }
+    // First index with a name not below the given (possibly partial) name.
+    uint32_t LowerBound(const uint8_t* name, size_t length) const {
+        uint32_t low = name[0] ? BigEndian32(index.data + 8 + (name[0] - 1) * 4) : 0;
+        uint32_t high = BigEndian32(index.data + 8 + name[0] * 4);
+        while (low < high) {
+            uint32_t mid = low + (high - low) / 2;
+            if (memcmp(names + size_t(mid) * 20, name, length) < 0) low = mid + 1;
+            else high = mid;
+        }
+        return low;
+    }
+    bool Find(const ObjectId& id, uint64_t& offset) const {
+        uint32_t n = LowerBound(id.data(), 20);
+        if (n >= count || memcmp(names + size_t(n) * 20, id.data(), 20) != 0) return false;
+        offset = OffsetOf(n);
+        return true;
+    }
+    uint64_t OffsetOf(uint32_t n) const {
+        uint32_t offset = BigEndian32(offsets + size_t(n) * 4);
+        if (!(offset & 0x80000000)) return offset;
+        const uint8_t* large = largeOffsets + size_t(offset & 0x7fffffff) * 8;
+        return (uint64_t(BigEndian32(large)) << 32) | BigEndian32(large + 4);
+    }
+    // Keeps an inflated object that deltas were applied to; the whole cache is dropped when it grows too large.
+    void CacheBase(uint64_t offset, ObjectType type, const std::string& data) {
+        if (baseCacheSize + data.size() > baseCacheLimit) {
+            baseCache.clear();
+            baseCacheSize = 0;
+        }
+        if (baseCache.emplace(offset, std::make_pair(type, data)).second) baseCacheSize += data.size();
+    }
+};
+
+#ifdef WITH_ZLIB
+// Inflates a zlib stream that may be followed by other data. For objects in packs the size is known up front.
+static bool Inflate(const uint8_t* in, size_t inSize, std::string& out, bool sizeKnown, size_t expected = 0) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) return false;
+    // One spare byte lets zlib see the end of the stream without growing the buffer.
+    out.resize(sizeKnown ? expected + 1 : std::max<size_t>(inSize * 4, 4096));
+    stream.next_in = const_cast<Bytef*>(in);
+    stream.avail_in = uInt(std::min<size_t>(inSize, 0x7fffffff));
+    int result;
+    do {
+        if (stream.total_out == out.size()) out.resize(out.size() * 2);
+        stream.next_out = reinterpret_cast<Bytef*>(&out[stream.total_out]);
+        stream.avail_out = uInt(out.size() - stream.total_out);
+        result = inflate(&stream, Z_NO_FLUSH);
+    } while (result == Z_OK);
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END && (!sizeKnown || out.size() == expected);
+}
+#else
+static bool Inflate(const uint8_t*, size_t, std::string&, bool, size_t = 0) {
+    return false;
+}
+#endif
+
+static bool ReadVarint(const uint8_t*& p, const uint8_t* end, size_t& value) {
+    value = 0;
+    for (unsigned shift = 0; p < end; shift += 7) {
+        uint8_t c = *p++;
+        value |= size_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool ApplyDelta(const std::string& base, const std::string& delta, std::string& out) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(delta.data());
+    const uint8_t* end = p + delta.size();
+    size_t baseSize, resultSize;
+    if (!ReadVarint(p, end, baseSize) || !ReadVarint(p, end, resultSize) || baseSize != base.size()) return false;
+    out.clear();
+    out.reserve(resultSize);
+    while (p < end) {
+        uint8_t op = *p++;
+        if (op & 0x80) {
+            // Copy from the base; the low bits tell which offset and size bytes follow.
+            size_t offset = 0, size = 0;
+            for (unsigned n = 0; n < 4; n++) {
+                if (op & (1 << n)) {
+                    if (p == end) return false;
+                    offset |= size_t(*p++) << (8 * n);
+                }
+            }
+            for (unsigned n = 0; n < 3; n++) {
+                if (op & (0x10 << n)) {
+                    if (p == end) return false;
+                    size |= size_t(*p++) << (8 * n);
+                }
+            }
+            if (size == 0) size = 0x10000;
+            if (offset + size > base.size()) return false;
+            out.append(base, offset, size);
+        } else if (op) {
+            if (size_t(end - p) < op) return false;
+            out.append(reinterpret_cast<const char*>(p), op);
+            p += op;
+        } else {
+            return false;
+        }
+    }
+    return out.size() == resultSize;
+}
+
+GitRepository::GitRepository(const std::filesystem::path& path)
+: cacheLimit(64 * 1024 * 1024)
+, valid(false)
+, cacheSize(0)
+{
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::absolute(path, ec).lexically_normal();
+    for (;;) {
+        std::filesystem::path dotGit = dir / ".git";
+        if (std::filesystem::is_directory(dotGit, ec)) {
+            gitDir = dotGit;
+            break;
+        }
+        if (std::filesystem::is_regular_file(dotGit, ec)) {
+            // Linked worktrees and submodules point to their git directory.
+            std::string content = ReadSmallFile(dotGit);
+            if (content.compare(0, 8, "gitdir: ") == 0) {
+                gitDir = dir / content.substr(8);
+                break;
+            }
+        }
+        if (std::filesystem::is_regular_file(dir / "HEAD", ec) && std::filesystem::is_directory(dir / "objects", ec)) {
+            gitDir = dir;
+            break;
+        }
+        if (!dir.has_relative_path()) return;
+        dir = dir.parent_path();
+    }
+    workTree = dir;
+    commonDir = gitDir;
+    if (std::filesystem::is_regular_file(gitDir / "commondir", ec)) {
+        commonDir = (gitDir / ReadSmallFile(gitDir / "commondir")).lexically_normal();
+    }
+    std::filesystem::path packDir = commonDir / "objects" / "pack";
+    if (std::filesystem::is_directory(packDir, ec)) {
+        std::vector<std::filesystem::path> indexes;
+        for (auto& entry : std::filesystem::directory_iterator(packDir, ec)) {
+            if (entry.path().extension() == ".idx") indexes.push_back(entry.path());
+        }
+        std::sort(indexes.begin(), indexes.end());
+        for (auto& idx : indexes) {
+            std::unique_ptr<PackFile> pack(new PackFile);
+            if (pack->Open(idx)) packs.push_back(std::move(pack));
+        }
+    }
+#ifdef WITH_ZLIB
+    valid = true;
+#endif
+}
+
+GitRepository::~GitRepository() {
+}
+
+bool GitRepository::ReadLooseObject(const ObjectId& id, ObjectType& type, std::string& data) {
+    std::string hex = ToHex(id);
+    MappedFile file;
+    if (!file.Open(commonDir / "objects" / hex.substr(0, 2) / hex.substr(2))) return false;
+    std::string raw;
+    if (!Inflate(file.data, file.size, raw, false)) return false;
+    size_t space = raw.find(' '), nul = raw.find('\0');
+    if (space == std::string::npos || nul == std::string::npos || space > nul) return false;
+    static const char* typeNames[] = { "", "commit", "tree", "blob", "tag" };
+    type = ObjectType::None;
+    for (int n = 1; n <= 4; n++) {
+        if (raw.compare(0, space, typeNames[n]) == 0) type = ObjectType(n);
+    }
+    data = raw.substr(nul + 1);
+    return type != ObjectType::None;
+}
+
+bool GitRepository::ReadPackedObject(PackFile& pack, uint64_t offset, ObjectType& type, std::string& data) {
+    // Follow the delta chain down to a base that is cached or stored whole, then apply the deltas back up.
+    std::vector<std::pair<uint64_t, std::string>> deltas;
+    std::string base;
+    const uint8_t* end = pack.pack.data + pack.pack.size;
+    for (;;) {
+        auto cached = pack.baseCache.find(offset);
+        if (cached != pack.baseCache.end()) {
+            type = cached->second.first;
+            base = cached->second.second;
+            break;
+        }
+        if (offset >= pack.pack.size) return false;
+        const uint8_t* p = pack.pack.data + offset;
+        uint8_t c = *p++;
+        const int kind = (c >> 4) & 7;
+        size_t size = c & 15;
+        for (unsigned shift = 4; c & 0x80; shift += 7) {
+            if (p == end) return false;
+            c = *p++;
+            size |= size_t(c & 0x7f) << shift;
+        }
+        if (kind >= 1 && kind <= 4) {
+            type = ObjectType(kind);
+            if (!Inflate(p, end - p, base, true, size)) return false;
+            // The bottom of a chain is usually shared with many other chains.
+            if (!deltas.empty()) pack.CacheBase(offset, type, base);
+            break;
+        }
+        std::string delta;
+        if (kind == 6) {
+            // Base at a negative offset within this pack.
+            if (p == end) return false;
+            c = *p++;
+            uint64_t distance = c & 0x7f;
+            while (c & 0x80) {
+                if (p == end) return false;
+                c = *p++;
+                distance = ((distance + 1) << 7) | (c & 0x7f);
+            }
+            if (!Inflate(p, end - p, delta, true, size) || distance > offset) return false;
+            deltas.push_back(std::make_pair(offset, std::move(delta)));
+            offset -= distance;
+        } else if (kind == 7) {
+            // Base by object name, which may live anywhere.
+            if (end - p < 20) return false;
+            ObjectId baseId;
+            memcpy(baseId.data(), p, 20);
+            if (!Inflate(p + 20, end - p - 20, delta, true, size)) return false;
+            deltas.push_back(std::make_pair(offset, std::move(delta)));
+            if (!pack.Find(baseId, offset)) {
+                if (!ReadObject(baseId, type, base)) return false;
+                break;
+            }
+        } else {
+            return false;
+        }
+    }
+    for (size_t n = deltas.size(); n-- > 0;) {
+        std::string result;
+        if (!ApplyDelta(base, deltas[n].second, result)) return false;
+        base.swap(result);
+        if (n > 0) pack.CacheBase(deltas[n].first, type, base);
+    }
+    data.swap(base);
+    return true;
+}
+
+bool GitRepository::ReadObject(const ObjectId& id, ObjectType& type, std::string& data) {
+    if (!valid) return false;
+    auto it = cache.find(id);
+    if (it != cache.end()) {
+        type = it->second.first;
+        data = it->second.second;
+        return true;
+    }
+    bool found = false;
+    for (auto& pack : packs) {
+        uint64_t offset;
+        if (pack->Find(id, offset)) {
+            found = ReadPackedObject(*pack, offset, type, data);
+            break;
+        }
+    }
+    if (!found && !ReadLooseObject(id, type, data)) return false;
+    if (cacheSize + data.size() > cacheLimit) {
+        cache.clear();
+        cacheSize = 0;
+    }
+    if (data.size() <= cacheLimit / 16) {
+        cacheSize += data.size();
+        cache[id] = std::make_pair(type, data);
+    }
+    return true;
+}
+
+bool GitRepository::ResolveRef(const std::string& name, ObjectId& id, int depth) {
+    if (depth > 5) return false;
+    std::error_code ec;
+    for (auto& dir : { gitDir, commonDir }) {
+        if (!std::filesystem::is_regular_file(dir / name, ec)) continue;
+        std::string content = ReadSmallFile(dir / name);
+        if (content.compare(0, 5, "ref: ") == 0) return ResolveRef(content.substr(5), id, depth + 1);
+        return FromHex(content, id);
+    }
+    std::ifstream packed(commonDir / "packed-refs");
+    std::string line;
+    while (std::getline(packed, line)) {
+        if (line.size() > 41 && line[0] != '#' && line[0] != '^' && line.compare(41, std::string::npos, name) == 0) {
+            return FromHex(line, id);
+        }
+    }
+    return false;
+}
+
+bool GitRepository::ResolveAbbreviation(const std::string& hex, ObjectId& id) {
+    std::vector<ObjectId> matches;
+    std::string padded = hex + std::string(40 - hex.size(), '0');
+    ObjectId low;
+    FromHex(padded, low);
+    const size_t fullBytes = hex.size() / 2;
+    auto matchesPrefix = [&](const uint8_t* name) {
+        if (memcmp(name, low.data(), fullBytes) != 0) return false;
+        return hex.size() % 2 == 0 || (name[fullBytes] >> 4) == (low[fullBytes] >> 4);
+    };
+    for (auto& pack : packs) {
+        for (uint32_t n = pack->LowerBound(low.data(), 20); n < pack->count && matchesPrefix(pack->names + size_t(n) * 20); n++) {
+            ObjectId match;
+            memcpy(match.data(), pack->names + size_t(n) * 20, 20);
+            matches.push_back(match);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::path looseDir = commonDir / "objects" / hex.substr(0, 2);
+    if (std::filesystem::is_directory(looseDir, ec)) {
+        for (auto& entry : std::filesystem::directory_iterator(looseDir, ec)) {
+            std::string name = hex.substr(0, 2) + entry.path().filename().string();
+            ObjectId match;
+            if (name.compare(0, hex.size(), hex) == 0 && FromHex(name, match)) matches.push_back(match);
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+    matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+    if (matches.size() != 1) return false;
+    id = matches[0];
+    return true;
+}
+
+// Follows annotated tags to the commit they point to.
+bool GitRepository::Peel(ObjectId& id) {
+    ObjectType type;
+    std::string data;
+    for (int depth = 0; depth < 10; depth++) {
+        if (!ReadObject(id, type, data)) return false;
+        if (type == ObjectType::Commit) return true;
+        if (type != ObjectType::Tag || data.compare(0, 7, "object ") != 0 || !FromHex(data.substr(7), id)) return false;
+    }
+    return false;
+}
+
+bool GitRepository::ResolveCommit(const std::string& revision, ObjectId& commit) {
+    if (!valid) return false;
+    const size_t suffix = std::min(revision.find('~'), revision.find('^'));
+    const std::string name = revision.substr(0, suffix);
+    bool found = false;
+    if (name.size() == 40 && IsHex(name)) {
+        found = FromHex(name, commit);
+    } else {
+        for (auto& candidate : { name, "refs/" + name, "refs/tags/" + name, "refs/heads/" + name,
+                                 "refs/remotes/" + name, "refs/remotes/" + name + "/HEAD" }) {
+            if (!name.empty() && ResolveRef(candidate, commit)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found && name.size() >= 4 && name.size() < 40 && IsHex(name)) {
+            found = ResolveAbbreviation(name, commit);
+        }
+    }
+    if (!found || !Peel(commit)) return false;
+
+    // Walk the ~n (n-th first parent) and ^n (n-th parent) suffixes.
+    for (size_t pos = suffix; pos < revision.size();) {
+        const char op = revision[pos++];
+        if (op != '~' && op != '^') return false;
+        size_t digits = pos;
+        while (digits < revision.size() && isdigit((unsigned char)revision[digits])) digits++;
+        const size_t count = digits > pos ? strtoul(revision.substr(pos, digits - pos).c_str(), NULL, 10) : 1;
+        pos = digits;
+        ObjectId tree;
+        std::vector<ObjectId> parents;
+        if (op == '~') {
+            for (size_t n = 0; n < count; n++) {
+                if (!ReadCommit(commit, tree, parents) || parents.empty()) return false;
+                commit = parents[0];
+            }
+        } else if (count > 0) {
+            if (!ReadCommit(commit, tree, parents) || parents.size() < count) return false;
+            commit = parents[count - 1];
+        }
+    }
+    return true;
+}
+
+bool GitRepository::ReadCommit(const ObjectId& commit, ObjectId& tree, std::vector<ObjectId>& parents, int64_t* time) {
+    ObjectType type;
+    std::string data;
+    if (!ReadObject(commit, type, data) || type != ObjectType::Commit) return false;
+    parents.clear();
+    bool hasTree = false;
+    std::istringstream in(data);
+    std::string line;
+    while (std::getline(in, line) && !line.empty()) {
+        ObjectId id;
+        if (line.compare(0, 5, "tree ") == 0 && FromHex(line.substr(5), id)) {
+            tree = id;
+            hasTree = true;
+        } else if (line.compare(0, 7, "parent ") == 0 && FromHex(line.substr(7), id)) {
+            parents.push_back(id);
+        } else if (time && line.compare(0, 10, "committer ") == 0) {
+            // committer Name <email> seconds timezone
+            size_t email = line.rfind('>');
+            *time = email == std::string::npos ? 0 : strtoll(line.c_str() + email + 1, NULL, 10);
+        }
+    }
+    return hasTree;
+}
+
+bool GitRepository::ReadTree(const ObjectId& tree, std::vector<TreeEntry>& entries) {
+    ObjectType type;
+    std::string data;
+    if (!ReadObject(tree, type, data) || type != ObjectType::Tree) return false;
+    entries.clear();
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t space = data.find(' ', pos), nul = data.find('\0', pos);
+        if (space == std::string::npos || nul == std::string::npos || nul + 21 > data.size()) return false;
+        const std::string mode = data.substr(pos, space - pos);
+        TreeEntry entry;
+        entry.name = data.substr(space + 1, nul - space - 1);
+        entry.isTree = mode == "40000";
+        entry.isFile = mode == "100644" || mode == "100755" || mode == "100664";
+        memcpy(entry.id.data(), data.data() + nul + 1, 20);
+        entries.push_back(entry);
+        pos = nul + 21;
+    }
+    return true;
+}
+
+bool GitRepository::FindTree(const ObjectId& root, const std::filesystem::path& directory, ObjectId& tree) {
+    tree = root;
+    std::vector<TreeEntry> entries;
+    for (auto& part : directory.lexically_normal()) {
+        const std::string name = part.generic_string();
+        if (name.empty() || name == ".") continue;
+        if (!ReadTree(tree, entries)) return false;
+        auto it = std::find_if(entries.begin(), entries.end(), [&](const TreeEntry& e) { return e.isTree && e.name == name; });
+        if (it == entries.end()) return false;
+        tree = it->id;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__GITREPOSITORY_H
+#define __DEP_CHECKER__GITREPOSITORY_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Binary SHA-1 object name.
+typedef std::array<uint8_t, 20> ObjectId;
+
+struct ObjectIdHash {
+    size_t operator()(const ObjectId& id) const {
+        size_t h;
+        memcpy(&h, id.data(), sizeof(h));
+        return h;
+    }
+};
+
+std::string ToHex(const ObjectId& id);
+bool FromHex(const std::string& hex, ObjectId& id);
+
+enum class ObjectType { None = 0, Commit = 1, Tree = 2, Blob = 3, Tag = 4 };
+
+struct TreeEntry {
+    std::string name;
+    bool isTree;
+    // Regular (possibly executable) file, as opposed to symlinks and submodules.
+    bool isFile;
+    ObjectId id;
+};
+
+struct PackFile;
+
+// Read-only access to the objects of a local git repository, straight from the loose objects and
+// packfiles without a checkout. Recently used objects are cached by object name and recently used
+// delta bases by their place in the pack, so that following delta chains stays cheap.
+class GitRepository {
+public:
+    // Opens the repository that holds path, looking upwards for its .git directory.
+    explicit GitRepository(const std::filesystem::path& path);
+    ~GitRepository();
+
+    // Whether a repository was found and git objects can be read in this build.
+    bool IsValid() const { return valid; }
+    // The directory of the working tree that holds the .git directory.
+    const std::filesystem::path& WorkTree() const { return workTree; }
+
+    // Resolves a full or abbreviated object name, HEAD, a branch, tag or other ref name, optionally
+    // followed by ~n and ^n to walk to ancestors, into the name of a commit.
+    bool ResolveCommit(const std::string& revision, ObjectId& commit);
+    bool ReadObject(const ObjectId& id, ObjectType& type, std::string& data);
+    // The root tree and parents of a commit, and optionally its commit time.
+    bool ReadCommit(const ObjectId& commit, ObjectId& tree, std::vector<ObjectId>& parents, int64_t* time = NULL);
+    bool ReadTree(const ObjectId& tree, std::vector<TreeEntry>& entries);
+    // The tree at a relative directory path below the given tree; "" or "." is the tree itself.
+    bool FindTree(const ObjectId& root, const std::filesystem::path& directory, ObjectId& tree);
+
+    size_t cacheLimit;
+
+private:
+    bool ResolveRef(const std::string& name, ObjectId& id, int depth = 0);
+    bool ResolveAbbreviation(const std::string& hex, ObjectId& id);
+    bool ReadLooseObject(const ObjectId& id, ObjectType& type, std::string& data);
+    bool ReadPackedObject(PackFile& pack, uint64_t offset, ObjectType& type, std::string& data);
+    bool Peel(ObjectId& id);
+
+    bool valid;
+    std::filesystem::path workTree, gitDir, commonDir;
+    std::vector<std::unique_ptr<PackFile>> packs;
+    std::unordered_map<ObjectId, std::pair<ObjectType, std::string>, ObjectIdHash> cache;
+    size_t cacheSize;
+};
+
+#endif
+
+
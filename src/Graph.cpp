@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Graph.h"
+#include "Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+
+// Amount of 64-bit words of targets handled per reachability block. Eight words keep a
+// full row in a single cache line.
+static const size_t wordsPerBlock = 8;
+
+Digraph MakeDigraph(size_t nodeCount, std::vector<std::pair<size_t, size_t>> edgeList) {
+    std::sort(edgeList.begin(), edgeList.end());
+    edgeList.erase(std::unique(edgeList.begin(), edgeList.end()), edgeList.end());
+    Digraph g;
+    g.edgeStart.assign(nodeCount + 1, 0);
+    g.edges.reserve(edgeList.size());
+    for (auto& e : edgeList) {
+        g.edgeStart[e.first + 1]++;
+        g.edges.push_back(e.second);
+    }
+    for (size_t n = 0; n < nodeCount; n++) {
+        g.edgeStart[n + 1] += g.edgeStart[n];
+    }
+    return g;
+}
+
+Digraph ReverseDigraph(const Digraph& g) {
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    edgeList.reserve(g.edges.size());
+    for (size_t n = 0; n < g.size(); n++) {
+        for (const size_t* it = g.begin(n); it != g.end(n); ++it) {
+            edgeList.push_back(std::make_pair(*it, n));
+        }
+    }
+    return MakeDigraph(g.size(), std::move(edgeList));
+}
+
+// Tarjan's algorithm, with an explicit stack so that deep include chains cannot overflow the call stack.
+Condensation Condense(const Digraph& g) {
+    const size_t n = g.size(), unvisited = static_cast<size_t>(-1);
+    std::vector<size_t> index(n, unvisited), lowlink(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<size_t> stack;
+    std::vector<std::pair<size_t, size_t>> callStack;
+    Condensation c;
+    c.componentOf.assign(n, 0);
+    c.memberStart.push_back(0);
+    c.members.reserve(n);
+    size_t counter = 0;
+    for (size_t root = 0; root < n; root++) {
+        if (index[root] != unvisited) continue;
+        index[root] = lowlink[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+        callStack.push_back(std::make_pair(root, g.edgeStart[root]));
+        while (!callStack.empty()) {
+            const size_t node = callStack.back().first;
+            if (callStack.back().second < g.edgeStart[node + 1]) {
+                const size_t next = g.edges[callStack.back().second++];
+                if (index[next] == unvisited) {
+                    index[next] = lowlink[next] = counter++;
+                    stack.push_back(next);
+                    onStack[next] = true;
+                    callStack.push_back(std::make_pair(next, g.edgeStart[next]));
+                } else if (onStack[next]) {
+                    lowlink[node] = std::min(lowlink[node], index[next]);
+                }
+                continue;
+            }
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                const size_t parent = callStack.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[node]);
+            }
+            if (lowlink[node] == index[node]) {
+                const size_t id = c.memberStart.size() - 1;
+                size_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    c.componentOf[member] = id;
+                    c.members.push_back(member);
+                } while (member != node);
+                c.memberStart.push_back(c.members.size());
+            }
+        }
+    }
+
+    const size_t componentCount = c.memberStart.size() - 1;
+    c.cyclic.assign(componentCount, false);
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    for (size_t node = 0; node < n; node++) {
+        const size_t from = c.componentOf[node];
+        for (const size_t* it = g.begin(node); it != g.end(node); ++it) {
+            const size_t to = c.componentOf[*it];
+            if (from != to) {
+                edgeList.push_back(std::make_pair(from, to));
+            } else {
+                c.cyclic[from] = true;
+            }
+        }
+    }
+    c.dag = MakeDigraph(componentCount, std::move(edgeList));
+    return c;
+}
+
+size_t WorkerCount() {
+    static const size_t count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    return count;
+}
+
+void ParallelFor(size_t count, const std::function<void(size_t, size_t)>& f) {
+    const size_t workers = std::min(WorkerCount(), count);
+    if (workers <= 1) {
+        for (size_t n = 0; n < count; n++) f(n, 0);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    const std::string stage = CurrentProfileStage();
+    for (size_t worker = 0; worker < workers; worker++) {
+        threads.emplace_back([&, worker]() {
+            ProfileScope span(stage.empty() ? "ParallelFor" : stage, ProfileScope::Worker, worker);
+            for (size_t n = next++; n < count; n = next++) f(n, worker);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void ForEachReachabilityBlock(const Condensation& c, const ReachabilityBlockHandler& handler) {
+    const size_t n = c.size(), bitsPerBlock = wordsPerBlock * 64;
+    std::vector<std::vector<uint64_t>> buffers(WorkerCount());
+    ParallelFor((n + bitsPerBlock - 1) / bitsPerBlock, [&](size_t block, size_t worker) {
+        const size_t first = block * bitsPerBlock, last = std::min(n, first + bitsPerBlock);
+        std::vector<uint64_t>& reach = buffers[worker];
+        reach.assign((n - first) * wordsPerBlock, 0);
+        // Nothing below first can reach the block, and dependencies always have a lower
+        // number, so one ascending pass sees every dependency before its users.
+        for (size_t comp = first; comp < n; comp++) {
+            uint64_t* row = &reach[(comp - first) * wordsPerBlock];
+            if (comp < last && c.cyclic[comp]) {
+                row[(comp - first) / 64] |= uint64_t(1) << ((comp - first) % 64);
+            }
+            for (const size_t* it = std::lower_bound(c.dag.begin(comp), c.dag.end(comp), first); it != c.dag.end(comp); ++it) {
+                const uint64_t* depRow = &reach[(*it - first) * wordsPerBlock];
+                for (size_t w = 0; w < wordsPerBlock; w++) {
+                    row[w] |= depRow[w];
+                }
+                if (*it < last) {
+                    row[(*it - first) / 64] |= uint64_t(1) << ((*it - first) % 64);
+                }
+            }
+        }
+        handler(first, last, reach, wordsPerBlock, worker);
+    });
+}
+
+std::vector<uint64_t> ReachableWeightSums(const Condensation& c, const std::vector<uint64_t>& weights) {
+    std::vector<std::vector<uint64_t>> sums(WorkerCount());
+    ForEachReachabilityBlock(c, [&](size_t first, size_t last, const std::vector<uint64_t>& reach, size_t words, size_t worker) {
+        // Sum of weights for every possible value of every byte in a row, so that summing a row
+        // takes a lookup per byte instead of a test per bit.
+        std::vector<uint64_t> table(words * 8 * 256, 0);
+        for (size_t byte = 0; byte < words * 8; byte++) {
+            uint64_t* t = &table[byte * 256];
+            for (size_t value = 1; value < 256; value++) {
+                size_t low = 0;
+                while (!(value & (size_t(1) << low))) low++;
+                const size_t target = first + byte * 8 + low;
+                t[value] = t[value & (value - 1)] + (target < last ? weights[target] : 0);
+            }
+        }
+        std::vector<uint64_t>& out = sums[worker];
+        out.resize(c.size(), 0);
+        for (size_t comp = first; comp < c.size(); comp++) {
+            const uint64_t* row = &reach[(comp - first) * words];
+            uint64_t total = 0;
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t word = row[w], byte = w * 8; word; word >>= 8, byte++) {
+                    total += table[byte * 256 + (word & 0xFF)];
+                }
+            }
+            out[comp] += total;
+        }
+    });
+    std::vector<uint64_t> result(c.size(), 0);
+    for (auto& s : sums) {
+        for (size_t n = 0; n < s.size(); n++) {
+            result[n] += s[n];
+        }
+    }
+    return result;
+}
+
+std::vector<uint64_t> ReachingWeightSums(const Condensation& c, const std::vector<uint64_t>& weights) {
+    // Reverse all edges and renumber the components back to front, which keeps every
+    // edge pointing from a higher to a lower number.
+    const size_t n = c.size();
+    Condensation reversed;
+    reversed.cyclic.resize(n);
+    std::vector<uint64_t> reversedWeights(n);
+    std::vector<std::pair<size_t, size_t>> edgeList;
+    edgeList.reserve(c.dag.edges.size());
+    for (size_t comp = 0; comp < n; comp++) {
+        reversed.cyclic[n - 1 - comp] = c.cyclic[comp];
+        reversedWeights[n - 1 - comp] = weights[comp];
+        for (const size_t* it = c.dag.begin(comp); it != c.dag.end(comp); ++it) {
+            edgeList.push_back(std::make_pair(n - 1 - *it, n - 1 - comp));
+        }
+    }
+    reversed.dag = MakeDigraph(n, std::move(edgeList));
+    std::vector<uint64_t> reversedSums = ReachableWeightSums(reversed, reversedWeights);
+    std::vector<uint64_t> result(n);
+    for (size_t comp = 0; comp < n; comp++) {
+        result[comp] = reversedSums[n - 1 - comp];
+    }
+    return result;
+}
+
+std::vector<double> BetweennessCentrality(const Digraph& g, size_t samples) {
+    const size_t n = g.size();
+    std::vector<size_t> sources(n);
+    std::iota(sources.begin(), sources.end(), 0);
+    if (samples > 0 && samples < n) {
+        std::mt19937 random(12345);
+        std::shuffle(sources.begin(), sources.end(), random);
+        sources.resize(samples);
+    }
+    Digraph reverse = ReverseDigraph(g);
+    struct Scratch {
+        std::vector<double> centrality, sigma, delta;
+        std::vector<size_t> distance, order;
+    };
+    const size_t unreached = static_cast<size_t>(-1);
+    // Sources are dealt out to a fixed number of accumulators so that the floating point
+    // sums do not depend on which thread happened to handle which source.
+    std::vector<Scratch> scratch(std::min(WorkerCount(), std::max<size_t>(1, sources.size())));
+    ParallelFor(scratch.size(), [&](size_t chunk, size_t) {
+        Scratch& w = scratch[chunk];
+        w.centrality.assign(n, 0);
+        w.sigma.assign(n, 0);
+        w.delta.assign(n, 0);
+        w.distance.assign(n, unreached);
+        for (size_t s = chunk; s < sources.size(); s += scratch.size()) {
+            // Breadth-first search counting shortest paths; order doubles as the queue.
+            w.order.clear();
+            w.order.push_back(sources[s]);
+            w.distance[sources[s]] = 0;
+            w.sigma[sources[s]] = 1;
+            for (size_t head = 0; head < w.order.size(); head++) {
+                const size_t v = w.order[head];
+                for (const size_t* it = g.begin(v); it != g.end(v); ++it) {
+                    if (w.distance[*it] == unreached) {
+                        w.distance[*it] = w.distance[v] + 1;
+                        w.order.push_back(*it);
+                    }
+                    if (w.distance[*it] == w.distance[v] + 1) {
+                        w.sigma[*it] += w.sigma[v];
+                    }
+                }
+            }
+            // Accumulate dependencies in order of decreasing distance, finding predecessors through the reverse graph.
+            for (size_t i = w.order.size(); i-- > 0;) {
+                const size_t node = w.order[i];
+                for (const size_t* it = reverse.begin(node); it != reverse.end(node); ++it) {
+                    if (w.distance[*it] != unreached && w.distance[*it] + 1 == w.distance[node]) {
+                        w.delta[*it] += w.sigma[*it] / w.sigma[node] * (1 + w.delta[node]);
+                    }
+                }
+                if (node != sources[s]) {
+                    w.centrality[node] += w.delta[node];
+                }
+            }
+            for (auto& node : w.order) {
+                w.sigma[node] = w.delta[node] = 0;
+                w.distance[node] = unreached;
+            }
+        }
+    });
+    std::vector<double> result(n, 0);
+    const double scale = sources.empty() ? 0 : double(n) / sources.size();
+    for (auto& w : scratch) {
+        for (size_t node = 0; node < w.centrality.size(); node++) {
+            result[node] += w.centrality[node] * scale;
+        }
+    }
+    return result;
+}
+
+std::vector<double> PageRank(const Digraph& g, double damping) {
+    const size_t n = g.size();
+    std::vector<double> rank(n, n ? 1.0 / n : 0), next(n);
+    for (size_t iteration = 0; iteration < 100; iteration++) {
+        // Rank of nodes without outgoing edges is spread evenly over all nodes.
+        double dangling = 0;
+        for (size_t node = 0; node < n; node++) {
+            if (g.begin(node) == g.end(node)) dangling += rank[node];
+        }
+        std::fill(next.begin(), next.end(), (1 - damping + damping * dangling) / n);
+        for (size_t node = 0; node < n; node++) {
+            const size_t outDegree = g.end(node) - g.begin(node);
+            for (const size_t* it = g.begin(node); it != g.end(node); ++it) {
+                next[*it] += damping * rank[node] / outDegree;
+            }
+        }
+        double change = 0;
+        for (size_t node = 0; node < n; node++) {
+            change += std::fabs(next[node] - rank[node]);
+        }
+        rank.swap(next);
+        if (change < 1e-12) break;
+    }
+    return rank;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__GRAPH_H
+#define __DEP_CHECKER__GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Compact directed graph on the nodes 0..size()-1. The outgoing edges of node n
+// are edges[edgeStart[n]] up to edges[edgeStart[n+1]].
+struct Digraph {
+    std::vector<size_t> edgeStart;
+    std::vector<size_t> edges;
+    size_t size() const { return edgeStart.empty() ? 0 : edgeStart.size() - 1; }
+    const size_t* begin(size_t node) const { return edges.data() + edgeStart[node]; }
+    const size_t* end(size_t node) const { return edges.data() + edgeStart[node + 1]; }
+};
+
+Digraph MakeDigraph(size_t nodeCount, std::vector<std::pair<size_t, size_t>> edgeList);
+
+Digraph ReverseDigraph(const Digraph& g);
+
+// Strongly connected components of a graph. Components are numbered in reverse
+// topological order, so every edge in the condensed graph goes from a higher to a
+// lower component number. A component is cyclic if its nodes can reach themselves.
+struct Condensation {
+    std::vector<size_t> componentOf;
+    std::vector<size_t> memberStart;
+    std::vector<size_t> members;
+    std::vector<bool> cyclic;
+    Digraph dag;
+    size_t size() const { return dag.size(); }
+};
+
+Condensation Condense(const Digraph& g);
+
+size_t WorkerCount();
+
+// Calls f(index, worker) for every index in [0, count), spread over WorkerCount() threads.
+void ParallelFor(size_t count, const std::function<void(size_t, size_t)>& f);
+
+// Reachability over a condensed graph, computed in blocks of target components.
+// For each block [first, last) the callback receives, for every component c >= first,
+// a bitset of wordsPerComponent words at reach[(c - first) * wordsPerComponent] telling
+// which targets in the block c can reach. A cyclic component reaches itself. Blocks
+// are processed in parallel; the last argument is the worker index.
+typedef std::function<void(size_t first, size_t last, const std::vector<uint64_t>& reach,
+                           size_t wordsPerComponent, size_t worker)> ReachabilityBlockHandler;
+void ForEachReachabilityBlock(const Condensation& c, const ReachabilityBlockHandler& handler);
+
+// For every component, the sum of weights of all components it can reach.
+std::vector<uint64_t> ReachableWeightSums(const Condensation& c, const std::vector<uint64_t>& weights);
+
+// For every component, the sum of weights of all components that can reach it.
+std::vector<uint64_t> ReachingWeightSums(const Condensation& c, const std::vector<uint64_t>& weights);
+
+// Betweenness centrality of every node with Brandes' algorithm, run from all nodes in parallel.
+// If samples is non-zero and less than the node count, only that many randomly chosen sources
+// are used and the result is scaled up to estimate the full value.
+std::vector<double> BetweennessCentrality(const Digraph& g, size_t samples);
+
+// PageRank of every node, with rank flowing along the edges.
+std::vector<double> PageRank(const Digraph& g, double damping);
+
+#endif
+
+
@@ -14,14 +14,18 @@
  * limitations under the License.
  */
 
+#include "Blacklist.h"
+#include "CmakeParser.h"
 #include "Component.h"
 #include "Configuration.h"
+#include "GitRepository.h"
 #include <filesystem>
 #include <fstream>
 #include "Input.h"
+#include "Profile.h"
 #include <algorithm>
-#include <assert.h>
 #include <cstring>
+#include <iostream>
 
 #ifdef WITH_MMAP
 #include <fcntl.h>
@@ -50,10 +54,9 @@ static bool IsCode(const std::string &ext) {
     return exts.count(ext) > 0;
 }
 
-static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool withLoc) {
-    if (buffersize == 0) return;
-    size_t offset = 0;
-    enum State { None, AfterHash, AfterInclude, InsidePointyIncludeBrackets, InsideStraightIncludeBrackets } state = None;
+// The part of the buffer up to the end of the line of its last preprocessor command.
+static size_t PreprocessorExtent(const char* buffer, size_t buffersize) {
+    if (buffersize == 0) return 0;
     // Try to terminate reading the file when we've read the last possible preprocessor command
     const char* lastHash = static_cast<const char*>(memrchr(buffer, '#', buffersize));
     if (lastHash) {
@@ -68,12 +71,15 @@ static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool wi
             }
         }
     }
-    if (withLoc) {
-        f.loc = 0;
-        for (size_t n = 0; n < buffersize; n++) {
-            if (buffer[n] == '\n') f.loc++;
-        }
-    }
+    return buffersize;
+}
+
+void ScanIncludeStatements(const char* buffer, size_t buffersize,
+                           const std::function<void(bool withPointyBrackets, size_t start, size_t end)>& onInclude) {
+    buffersize = PreprocessorExtent(buffer, buffersize);
+    if (buffersize == 0) return;
+    size_t offset = 0;
+    enum State { None, AfterHash, AfterInclude, InsidePointyIncludeBrackets, InsideStraightIncludeBrackets } state = None;
     const char* nextHash = static_cast<const char*>(memchr(buffer+offset, '#', buffersize-offset));
     const char* nextSlash = static_cast<const char*>(memchr(buffer+offset, '/', buffersize-offset));
     size_t start = 0;
@@ -160,7 +166,7 @@ static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool wi
                 state = None; // Buggy code, skip over this include.
                 break;
             case '>':
-                f.AddIncludeStmt(true, std::string(&buffer[start], &buffer[offset]));
+                onInclude(true, start, offset);
                 state = None;
                 break;
             }
@@ -171,7 +177,7 @@ static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool wi
                 state = None; // Buggy code, skip over this include.
                 break;
             case '\"':
-                f.AddIncludeStmt(false, std::string(&buffer[start], &buffer[offset]));
+                onInclude(false, start, offset);
                 state = None;
                 break;
             }
@@ -181,6 +187,27 @@ static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool wi
     }
 }
 
+static void ReadCodeFrom(File& f, const char* buffer, size_t buffersize, bool withLoc) {
+    ProfileScope scope("ReadCodeFrom", ProfileScope::Detail);
+    if (withLoc) {
+        const size_t extent = PreprocessorExtent(buffer, buffersize);
+        f.loc = 0;
+        for (size_t n = 0; n < extent; n++) {
+            if (buffer[n] == '\n') f.loc++;
+        }
+    }
+    size_t includes = 0;
+    ScanIncludeStatements(buffer, buffersize, [&](bool withPointyBrackets, size_t start, size_t end) {
+        f.AddIncludeStmt(withPointyBrackets, std::string(buffer + start, buffer + end));
+        includes++;
+    });
+    if (ProfilingEnabled()) {
+        CountProfile("files read", 1);
+        CountProfile("bytes read", buffersize);
+        CountProfile("includes parsed", includes);
+    }
+}
+
 #ifdef WITH_MMAP
 static void ReadCode(std::unordered_map<std::string, File>& files, const std::filesystem::path &path, bool withLoc) {
     File& f = files.insert(std::make_pair(path.generic_string(), File(path))).first->second;
@@ -203,113 +230,107 @@ static void ReadCode(std::unordered_map<std::string, File>& files, const std::fi
 }
 #endif
 
-static bool IsItemBlacklisted(const Configuration& config, const std::filesystem::path &path) {
-    std::string pathS = path.generic_string();
-    std::string fileName = path.filename().generic_string();
-    for (auto& s : config.blacklist) {
-        if (pathS.compare(2, s.size(), s) == 0) {
-            return true;
+enum class CmakeSection { Custom, Generated, IfFirstArgument, IfAnyArgument };
+
+// Whether a command is one that --regen writes itself, and so is not kept as a custom section.
+static bool IsAutomaticlyGeneratedSection(const CmakeCommand& command) {
+    static const std::unordered_map<std::string, std::pair<CmakeSection, std::vector<std::string>>> sections = {
+        { "target_link_libraries", { CmakeSection::Generated, {} } },
+        { "add_subdirectory", { CmakeSection::Generated, {} } },
+        { "target_include_directories", { CmakeSection::Generated, {} } },
+        { "target_precompile_headers", { CmakeSection::Generated, {} } },
+        { "add_dependencies", { CmakeSection::Generated, {} } },
+        { "include", { CmakeSection::IfFirstArgument, { "CMakeAddon.txt" } } },
+        { "source_group", { CmakeSection::IfFirstArgument, { "Implementation\\" } } },
+        { "set", { CmakeSection::IfFirstArgument, { "IMPLEMENTATION_SOURCES", "IMPLEMENTATION_HEADERS", "INTERFACE_FILES" } } },
+        { "set_target_properties", { CmakeSection::IfAnyArgument, { "UNITY_BUILD_MODE" } } },
+        { "set_source_files_properties", { CmakeSection::IfAnyArgument, { "UNITY_GROUP" } } },
+    };
+    std::string name = command.name;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    auto it = sections.find(name);
+    if (it == sections.end()) return false;
+    const std::vector<std::string>& words = it->second.second;
+    switch (it->second.first) {
+    case CmakeSection::Generated:
+        return true;
+    case CmakeSection::IfFirstArgument:
+        if (command.args.empty()) return false;
+        for (auto& w : words) {
+            if (command.args[0].value.compare(0, w.size(), w) == 0) return true;
+        }
+        return false;
+    case CmakeSection::IfAnyArgument:
+        for (auto& arg : command.args) {
+            if (std::find(words.begin(), words.end(), arg.value) != words.end()) return true;
         }
-        if (s == fileName) 
-            return true;
+        return false;
+    default:
+        return false;
     }
-    return false;
 }
 
-static bool TryGetComponentType(Component& component,
-                                std::unordered_set<std::string> componentTypes,
-                                const std::string& line)
-{
-  for (std::unordered_set<std::string>::const_iterator it = componentTypes.begin();
-       it != componentTypes.end();
-       ++it)
-  {
-    if (strstr(line.c_str(), it->c_str()))
-    {
-      component.type = *it;
-      return true;
-    }
-  }
-  return false;
+static size_t LineStart(const char* data, size_t offset) {
+    while (offset > 0 && data[offset - 1] != '\n') offset--;
+    return offset;
 }
 
-static bool IsAutomaticlyGeneratedSection(std::string line) {
-    return strstr(line.c_str(), "target_link_libraries(") ||
-           strstr(line.c_str(), "add_subdirectory(") ||
-           strstr(line.c_str(), "target_include_directories(") ||
-           strstr(line.c_str(), "add_dependencies(") ||
-           strstr(line.c_str(), "include(CMakeAddon.txt)") ||
-           strstr(line.c_str(), "source_group(\"Implementation\\") ||
-           strstr(line.c_str(), "set(IMPLEMENTATION_SOURCES") ||
-           strstr(line.c_str(), "set(IMPLEMENTATION_HEADERS") ||
-           strstr(line.c_str(), "set(INTERFACE_FILES");
+static size_t LineEnd(const char* data, size_t size, size_t offset) {
+    while (offset < size && data[offset] != '\n') offset++;
+    return offset;
 }
 
 static void ReadCmakelist(const Configuration& config, std::unordered_map<std::string, Component *> &components,
-                          const std::filesystem::path &path) {
-    std::ifstream in(path);
-    std::string line;
+                          const std::filesystem::path &path, const char* data, size_t size) {
     Component &comp = AddComponentDefinition(components, path.parent_path());
-    bool inTargetDefinition = false;
-    bool inAutoSection = false;
-    int parenLevel = 0;
-    do {
-        getline(in, line);
-        if (strstr(line.c_str(), config.regenTag.c_str())) {
+    CmakeFile file = ParseCmake(data, size);
+    for (auto& comment : file.comments) {
+        if (comment.find(config.regenTag) != std::string::npos) {
             comp.recreate = true;
-            continue;
         }
-        if (line.size() > 0 && line[0] == '#') {
-            continue;
-        }
-        size_t start = line.find("\"");
-        while (start != std::string::npos) {
-            size_t end = line.find("\"", start+1);
-            line.replace(start+1, end - start - 1, "");
-            start = line.find("\"", start+2);
-        }
-        int newParenLevel = parenLevel + std::count(line.begin(), line.end(), '(')
-                                - std::count(line.begin(), line.end(), ')');
-        if (strstr(line.c_str(), "project(") == line.c_str()) {
-            size_t end = line.find(')');
-            if (end != line.npos) {
-                comp.name = line.substr(8, end - 8);
+    }
+    // Custom sections are copied as whole lines; this is the end of the last line copied.
+    size_t copiedUntil = 0;
+    for (auto& command : file.commands) {
+        if (command.name == "project") {
+            if (!command.args.empty()) {
+                comp.name = command.args[0].value;
             }
-        }
-        else if (TryGetComponentType(comp, config.addLibraryAliases, line)) {
-            inTargetDefinition = true;
-        } else if (TryGetComponentType(comp, config.addExecutableAliases, line)) {
-            inTargetDefinition = true;
-        } else if (inTargetDefinition) {
-            const size_t endOfLine = (newParenLevel == 0) ? line.find_last_of(')')
-                                                          : line.length();
-            if (endOfLine > 0) {
-                const std::string targetLine(line.substr(0, endOfLine));
-                if (!strstr(targetLine.c_str(), "${IMPLEMENTATION_SOURCES}") &&
-                    !strstr(targetLine.c_str(), "${IMPLEMENTATION_HEADERS}") &&
-                    !IsCode(std::filesystem::path(targetLine).extension().generic_string())) {
-                    comp.additionalTargetParameters.append(targetLine + '\n');
+        } else if (config.addLibraryAliases.count(command.name) || config.addExecutableAliases.count(command.name)) {
+            comp.type = command.name;
+            // Everything after the first line, apart from the files that --regen lists itself, is kept line by line.
+            std::string targetLine;
+            size_t line = command.line;
+            for (auto& arg : command.args) {
+                if (arg.line == command.line ||
+                    arg.value == "${IMPLEMENTATION_SOURCES}" ||
+                    arg.value == "${IMPLEMENTATION_HEADERS}" ||
+                    IsCode(std::filesystem::path(arg.value).extension().generic_string())) {
+                    continue;
                 }
-            }
-            if (newParenLevel == 0) {
-                inTargetDefinition = false;
-            }
-        } else if (config.reuseCustomSections) {
-            if (IsAutomaticlyGeneratedSection(line))
-            {
-                inAutoSection = true;
-            } else {
-                if (!inAutoSection && !line.empty()) {
-                    comp.additionalCmakeDeclarations.append(line + '\n');
+                if (arg.line != line) {
+                    if (!targetLine.empty()) comp.additionalTargetParameters.append(targetLine + '\n');
+                    line = arg.line;
+                    targetLine = "  ";
+                } else {
+                    targetLine += ' ';
                 }
+                targetLine += arg.spelling;
             }
-            if (inAutoSection && newParenLevel == 0) {
-                inAutoSection = false;
+            if (!targetLine.empty()) comp.additionalTargetParameters.append(targetLine + '\n');
+        } else if (config.reuseCustomSections && !IsAutomaticlyGeneratedSection(command)) {
+            size_t begin = std::max(LineStart(data, command.begin), copiedUntil);
+            size_t end = LineEnd(data, size, command.end);
+            while (begin < end) {
+                size_t lineEnd = LineEnd(data, size, begin);
+                std::string line(data + begin, lineEnd - begin);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) comp.additionalCmakeDeclarations.append(line + '\n');
+                begin = lineEnd + 1;
             }
+            copiedUntil = std::max(copiedUntil, end);
         }
-        parenLevel = newParenLevel;
-    } while (in.good());
-    assert(parenLevel == 0 || (printf("final level of parentheses=%d\n", parenLevel), 0));
+    }
 }
 
 void LoadFileList(const Configuration& config,
@@ -321,14 +342,16 @@ void LoadFileList(const Configuration& config,
     std::filesystem::path outputpath = std::filesystem::current_path();
     std::filesystem::current_path(sourceDir.c_str());
     AddComponentDefinition(components, ".");
+    const BlacklistMatcher blacklist(config.blacklist);
     for (std::filesystem::recursive_directory_iterator it("."), end;
          it != end; ++it) {
         const auto &parent = it->path().parent_path();
 
         // skip hidden files and dirs
-        std::string fileName = it->path().filename().generic_string();
-        if ((fileName.size() >= 2 && fileName[0] == '.') ||
-            IsItemBlacklisted(config, it->path())) {
+        const std::string pathS = it->path().generic_string();
+        const size_t nameStart = pathS.find_last_of('/') + 1;
+        if ((pathS.size() - nameStart >= 2 && pathS[nameStart] == '.') ||
+            blacklist.Matches(pathS)) {
 #ifdef WITH_BOOST
             it.no_push();
 #else
@@ -340,7 +363,10 @@ void LoadFileList(const Configuration& config,
         if (inferredComponents) AddComponentDefinition(components, parent);
 
         if (it->path().filename() == "CMakeLists.txt") {
-            ReadCmakelist(config, components, it->path());
+            std::string content;
+            content.resize(std::filesystem::file_size(it->path()));
+            std::ifstream(it->path(), std::ios::binary).read(&content[0], content.size());
+            ReadCmakelist(config, components, it->path(), content.data(), content.size());
         } else if (std::filesystem::is_regular_file(it->status())) {
             if (it->path().generic_string().find("CMakeAddon.txt") != std::string::npos) {
                 AddComponentDefinition(components, parent).hasAddonCmake = true;
@@ -352,10 +378,104 @@ void LoadFileList(const Configuration& config,
     std::filesystem::current_path(outputpath);
 }
 
+// Same as the directory walk above, but for a tree in a git repository.
+static void LoadTreeFromGit(const Configuration& config,
+                            std::unordered_map<std::string, Component *> &components,
+                            std::unordered_map<std::string, File>& files,
+                            const BlacklistMatcher& blacklist,
+                            GitRepository& repository,
+                            const ObjectId& tree,
+                            const std::filesystem::path& dir,
+                            bool inferredComponents,
+                            bool withLoc,
+                            BlobScanCache* scanCache) {
+    std::vector<TreeEntry> entries;
+    if (!repository.ReadTree(tree, entries)) {
+        std::cout << "Cannot read git tree " << ToHex(tree) << " for " << dir.generic_string() << "\n";
+        return;
+    }
+    std::string content;
+    ObjectType type;
+    for (auto &entry : entries) {
+        const std::filesystem::path path = dir / entry.name;
+        if ((entry.name.size() >= 2 && entry.name[0] == '.') ||
+            blacklist.Matches(path.generic_string())) {
+            continue;
+        }
+
+        if (inferredComponents) AddComponentDefinition(components, dir);
+
+        if (entry.isTree) {
+            LoadTreeFromGit(config, components, files, blacklist, repository, entry.id, path, inferredComponents, withLoc, scanCache);
+        } else if (!entry.isFile) {
+            continue;
+        } else if (entry.name == "CMakeLists.txt") {
+            if (repository.ReadObject(entry.id, type, content)) {
+                ReadCmakelist(config, components, path, content.data(), content.size());
+            }
+        } else if (path.generic_string().find("CMakeAddon.txt") != std::string::npos) {
+            AddComponentDefinition(components, dir).hasAddonCmake = true;
+        } else if (IsCode(path.extension().generic_string())) {
+            File& f = files.insert(std::make_pair(path.generic_string(), File(path))).first->second;
+            auto scanned = scanCache ? scanCache->find(entry.id) : BlobScanCache::iterator();
+            if (scanCache && scanned != scanCache->end()) {
+                f.rawIncludes = scanned->second.rawIncludes;
+                f.loc = scanned->second.loc;
+            } else if (repository.ReadObject(entry.id, type, content)) {
+                ReadCodeFrom(f, content.data(), content.size(), withLoc);
+                if (scanCache) (*scanCache)[entry.id] = ScannedBlob{ f.rawIncludes, f.loc };
+            }
+        }
+    }
+}
+
+bool LoadFileListFromGit(const Configuration& config,
+                         std::unordered_map<std::string, Component *> &components,
+                         std::unordered_map<std::string, File>& files,
+                         const std::filesystem::path& sourceDir,
+                         const std::string& revision,
+                         bool inferredComponents,
+                         bool withLoc) {
+    GitRepository repository(sourceDir);
+    if (!repository.IsValid()) {
+        std::cout << "No git repository found for " << sourceDir.string() << ", or built without zlib\n";
+        return false;
+    }
+    ObjectId commit, root, tree;
+    std::vector<ObjectId> parents;
+    if (!repository.ResolveCommit(revision, commit) || !repository.ReadCommit(commit, root, parents)) {
+        std::cout << "Cannot find git revision " << revision << "\n";
+        return false;
+    }
+    // Analyze the same subdirectory of the repository as for a checkout.
+    std::error_code ec;
+    std::filesystem::path subdir = std::filesystem::absolute(sourceDir, ec).lexically_normal().lexically_relative(repository.WorkTree());
+    if (!repository.FindTree(root, subdir, tree)) {
+        std::cout << "Directory " << subdir.generic_string() << " does not exist in git revision " << revision << "\n";
+        return false;
+    }
+    LoadFileListFromGit(config, components, files, repository, tree, inferredComponents, withLoc, NULL);
+    return true;
+}
+
+void LoadFileListFromGit(const Configuration& config,
+                         std::unordered_map<std::string, Component *> &components,
+                         std::unordered_map<std::string, File>& files,
+                         GitRepository& repository,
+                         const ObjectId& tree,
+                         bool inferredComponents,
+                         bool withLoc,
+                         BlobScanCache* scanCache) {
+    AddComponentDefinition(components, ".");
+    LoadTreeFromGit(config, components, files, BlacklistMatcher(config.blacklist), repository, tree, ".", inferredComponents, withLoc, scanCache);
+}
+
 void ForgetEmptyComponents(std::unordered_map<std::string, Component *> &components) {
   for (auto it = begin(components); it != end(components);) {
-    if (it->second->files.empty())
+    if (it->second->files.empty()) {
+      delete it->second;
       it = components.erase(it);
+    }
     else
       ++it;
   }
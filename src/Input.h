@@ -17,16 +17,31 @@
 #ifndef __DEP_CHECKER__INPUT_H
 #define __DEP_CHECKER__INPUT_H
 
+#include "GitRepository.h"
 #include <filesystem>
+#include <functional>
+#include <map>
 #include <regex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 
+struct Configuration;
 struct File;
 struct Component;
 
 bool IsCompileableFile(const std::string& ext);
+// Calls onInclude with the offsets of the path of every #include and #import in the buffer, between the
+// quotes or angle brackets. Includes in comments are skipped.
+void ScanIncludeStatements(const char* buffer, size_t buffersize,
+                           const std::function<void(bool withPointyBrackets, size_t start, size_t end)>& onInclude);
+
+// What scanning a file found, by git blob name, to reuse when the same blob shows up in another revision.
+struct ScannedBlob {
+    std::map<std::string, bool> rawIncludes;
+    size_t loc;
+};
+typedef std::unordered_map<ObjectId, ScannedBlob, ObjectIdHash> BlobScanCache;
 
 void ForgetEmptyComponents(std::unordered_map<std::string, Component *> &components);
 void LoadFileList(const Configuration& config,
@@ -35,6 +50,24 @@ void LoadFileList(const Configuration& config,
                   const std::filesystem::path& sourceDir,
                   bool inferredComponents,
                   bool withLoc);
+// Loads the files of sourceDir as they are in a revision of the git repository holding it,
+// reading the repository objects instead of the working tree.
+bool LoadFileListFromGit(const Configuration& config,
+                         std::unordered_map<std::string, Component *> &components,
+                         std::unordered_map<std::string, File>& files,
+                         const std::filesystem::path& sourceDir,
+                         const std::string& revision,
+                         bool inferredComponents,
+                         bool withLoc);
+// Loads the files of a git tree. If scanCache is given, blobs already in it are not read again.
+void LoadFileListFromGit(const Configuration& config,
+                         std::unordered_map<std::string, Component *> &components,
+                         std::unordered_map<std::string, File>& files,
+                         GitRepository& repository,
+                         const ObjectId& tree,
+                         bool inferredComponents,
+                         bool withLoc,
+                         BlobScanCache* scanCache);
 
 #endif
 
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryStats.h"
+#include "Component.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <sstream>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<bool> enabled(false);
+std::atomic<uint64_t> allocations(0), allocatedBytes(0), freedBytes(0);
+
+// The size of a heap block as the allocator sees it, or 0 where the platform can't tell.
+size_t BlockSize(void* p) {
+#if defined(__GLIBC__)
+    return malloc_usable_size(p);
+#elif defined(__APPLE__)
+    return malloc_size(p);
+#elif defined(_WIN32)
+    return _msize(p);
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+struct MemoryStage {
+    std::string name;
+    HeapCounters during, atEnd;
+    uint64_t rss, peakRss;
+    std::vector<ContainerEstimate> containers;
+};
+
+struct MemoryState {
+    std::mutex mutex;
+    std::function<std::vector<ContainerEstimate>()> sampler;
+    std::vector<MemoryStage> stages;
+};
+
+MemoryState& State() {
+    static MemoryState state;
+    return state;
+}
+
+template <typename String>
+uint64_t StringBytes(const String& s) {
+    // Short strings live inside the string object itself.
+    const char* data = reinterpret_cast<const char*>(s.data());
+    const char* object = reinterpret_cast<const char*>(&s);
+    if (data >= object && data < object + sizeof(s)) return 0;
+    return (s.capacity() + 1) * sizeof(typename String::value_type);
+}
+
+// Node-based containers, assuming a node holds the value and a next pointer and cached hash for hash
+// tables, or a color and three pointers for trees.
+template <typename C>
+uint64_t HashTableBytes(const C& c) {
+    return c.bucket_count() * sizeof(void*) + c.size() * (sizeof(typename C::value_type) + 2 * sizeof(void*));
+}
+
+template <typename C>
+uint64_t TreeBytes(const C& c) {
+    return c.size() * (sizeof(typename C::value_type) + 4 * sizeof(void*));
+}
+
+}
+
+static void* CountedAllocate(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (p && enabled.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(BlockSize(p), std::memory_order_relaxed);
+    }
+    return p;
+}
+
+static void CountedFree(void* p) {
+    if (p && enabled.load(std::memory_order_relaxed)) {
+        freedBytes.fetch_add(BlockSize(p), std::memory_order_relaxed);
+    }
+    std::free(p);
+}
+
+void* operator new(std::size_t size) {
+    void* p = CountedAllocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = CountedAllocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAllocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    CountedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+    CountedFree(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    CountedFree(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    CountedFree(p);
+}
+
+void EnableMemoryStats() {
+    State();
+    enabled = true;
+}
+
+bool MemoryStatsEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+HeapCounters ReadHeapCounters() {
+    return HeapCounters{ allocations.load(std::memory_order_relaxed),
+                         allocatedBytes.load(std::memory_order_relaxed),
+                         freedBytes.load(std::memory_order_relaxed) };
+}
+
+bool ReadResidentSetSize(uint64_t& current, uint64_t& peak) {
+    std::ifstream in("/proc/self/status");
+    std::string key;
+    bool haveCurrent = false, havePeak = false;
+    while (in >> key) {
+        uint64_t kilobytes;
+        if (key == "VmRSS:" && in >> kilobytes) {
+            current = kilobytes * 1024;
+            haveCurrent = true;
+        } else if (key == "VmHWM:" && in >> kilobytes) {
+            peak = kilobytes * 1024;
+            havePeak = true;
+        }
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return haveCurrent && havePeak;
+}
+
+std::vector<ContainerEstimate> EstimateContainers(const std::unordered_map<std::string, File>& files,
+                                                  const std::unordered_map<std::string, Component *>& components,
+                                                  const std::unordered_map<std::string, std::string>& includeLookup,
+                                                  const std::map<std::string, std::set<std::string>>& collisions,
+                                                  const std::map<std::string, std::vector<std::string>>& ambiguous) {
+    ContainerEstimate filesMap{ "files", files.size(), HashTableBytes(files) },
+                      paths{ "File::path", 0, 0 },
+                      rawIncludes{ "File::rawIncludes", 0, 0 },
+                      fileLinks{ "File::dependencies/includedBy", 0, 0 },
+                      includePaths{ "File::includePaths", 0, 0 };
+    for (auto& f : files) {
+        filesMap.bytes += StringBytes(f.first);
+        paths.elements++;
+        paths.bytes += StringBytes(f.second.path.native());
+        rawIncludes.elements += f.second.rawIncludes.size();
+        rawIncludes.bytes += TreeBytes(f.second.rawIncludes);
+        for (auto& i : f.second.rawIncludes) rawIncludes.bytes += StringBytes(i.first);
+        fileLinks.elements += f.second.dependencies.size() + f.second.includedBy.size();
+        fileLinks.bytes += HashTableBytes(f.second.dependencies) + HashTableBytes(f.second.includedBy);
+        includePaths.elements += f.second.includePaths.size();
+        includePaths.bytes += HashTableBytes(f.second.includePaths);
+        for (auto& p : f.second.includePaths) includePaths.bytes += StringBytes(p);
+    }
+
+    ContainerEstimate lookup{ "includeLookup", includeLookup.size(), HashTableBytes(includeLookup) };
+    for (auto& l : includeLookup) lookup.bytes += StringBytes(l.first) + StringBytes(l.second);
+
+    ContainerEstimate collisionMap{ "collisions", collisions.size(), TreeBytes(collisions) };
+    for (auto& c : collisions) {
+        collisionMap.bytes += StringBytes(c.first) + TreeBytes(c.second);
+        for (auto& s : c.second) collisionMap.bytes += StringBytes(s);
+    }
+
+    ContainerEstimate ambiguousMap{ "ambiguous", ambiguous.size(), TreeBytes(ambiguous) };
+    for (auto& a : ambiguous) {
+        ambiguousMap.bytes += StringBytes(a.first) + a.second.capacity() * sizeof(std::string);
+        for (auto& s : a.second) ambiguousMap.bytes += StringBytes(s);
+    }
+
+    ContainerEstimate componentMap{ "components", components.size(), HashTableBytes(components) },
+                      links{ "Component deps/links/circulars", 0, 0 },
+                      componentFiles{ "Component::files", 0, 0 },
+                      includeReasons{ "Component::includeReasons", 0, 0 };
+    for (auto& c : components) {
+        componentMap.bytes += StringBytes(c.first);
+        if (!c.second) continue;
+        const Component& comp = *c.second;
+        componentMap.bytes += sizeof(Component) + StringBytes(comp.root.native()) + StringBytes(comp.name) +
+                              StringBytes(comp.type) + StringBytes(comp.additionalTargetParameters) +
+                              StringBytes(comp.additionalCmakeDeclarations);
+        for (auto* set : { &comp.pubDeps, &comp.privDeps, &comp.pubLinks, &comp.privLinks, &comp.circulars, &comp.impliedDeps }) {
+            links.elements += set->size();
+            links.bytes += HashTableBytes(*set);
+        }
+        componentFiles.elements += comp.files.size();
+        componentFiles.bytes += HashTableBytes(comp.files);
+        includeReasons.bytes += HashTableBytes(comp.includeReasons);
+        for (auto& r : comp.includeReasons) {
+            includeReasons.elements += r.second.size();
+            includeReasons.bytes += r.second.capacity() * sizeof(r.second[0]);
+        }
+    }
+
+    return { filesMap, paths, rawIncludes, fileLinks, includePaths, lookup, collisionMap, ambiguousMap,
+             componentMap, links, componentFiles, includeReasons };
+}
+
+void SetContainerSampler(const std::function<std::vector<ContainerEstimate>()>& sampler) {
+    MemoryState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.sampler = sampler;
+}
+
+void RecordMemoryStage(const std::string& name, const HeapCounters& atStart) {
+    MemoryStage stage;
+    stage.name = name;
+    stage.atEnd = ReadHeapCounters();
+    stage.during = HeapCounters{ stage.atEnd.allocations - atStart.allocations,
+                                 stage.atEnd.allocatedBytes - atStart.allocatedBytes,
+                                 stage.atEnd.freedBytes - atStart.freedBytes };
+    stage.rss = stage.peakRss = 0;
+    ReadResidentSetSize(stage.rss, stage.peakRss);
+    MemoryState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.sampler) stage.containers = state.sampler();
+    state.stages.push_back(std::move(stage));
+}
+
+static std::string Megabytes(int64_t bytes) {
+    std::ostringstream o;
+    o << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0);
+    return o.str();
+}
+
+void PrintMemoryStats(std::ostream& out) {
+    MemoryState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    size_t width = 5;
+    for (auto& s : state.stages) width = std::max(width, s.name.size());
+    const std::ios_base::fmtflags flags = out.flags();
+    out << "\nMemory (MB; heap counted since --memstats, stages in the order they finished):\n";
+    out << "  " << std::left << std::setw(width) << "Stage" << std::right
+        << std::setw(13) << "allocations" << std::setw(11) << "allocated" << std::setw(10) << "net"
+        << std::setw(10) << "heap" << std::setw(10) << "rss" << std::setw(10) << "peak rss" << "\n";
+    for (auto& s : state.stages) {
+        out << "  " << std::left << std::setw(width) << s.name << std::right
+            << std::setw(13) << s.during.allocations
+            << std::setw(11) << Megabytes(s.during.allocatedBytes)
+            << std::setw(10) << Megabytes(int64_t(s.during.allocatedBytes - s.during.freedBytes))
+            << std::setw(10) << Megabytes(int64_t(s.atEnd.allocatedBytes - s.atEnd.freedBytes))
+            << std::setw(10) << Megabytes(s.rss) << std::setw(10) << Megabytes(s.peakRss) << "\n";
+    }
+
+    // Containers after every stage, listing only those that changed since the stage before.
+    std::map<std::string, std::pair<size_t, uint64_t>> previous;
+    for (auto& s : state.stages) {
+        bool printedHeader = false;
+        for (auto& c : s.containers) {
+            auto& last = previous[c.name];
+            if (last == std::make_pair(c.elements, c.bytes)) continue;
+            last = std::make_pair(c.elements, c.bytes);
+            if (!printedHeader) {
+                out << "\n  Containers after " << s.name << ":\n";
+                printedHeader = true;
+            }
+            out << "    " << std::left << std::setw(32) << c.name << std::right << std::setw(12) << c.elements
+                << " elements" << std::setw(10) << Megabytes(c.bytes) << " MB\n";
+        }
+    }
+    out.flags(flags);
+}
+
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__MEMORYSTATS_H
+#define __DEP_CHECKER__MEMORYSTATS_H
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Component;
+struct File;
+
+// Memory accounting for --memstats. Heap use is counted by the global operator new and delete from the
+// moment EnableMemoryStats is called; blocks allocated before that and freed after it count as freed.
+void EnableMemoryStats();
+bool MemoryStatsEnabled();
+
+struct HeapCounters {
+    uint64_t allocations, allocatedBytes, freedBytes;
+};
+HeapCounters ReadHeapCounters();
+
+// Current and peak resident set size of the process in bytes, where the platform reports them.
+bool ReadResidentSetSize(uint64_t& current, uint64_t& peak);
+
+// An estimate of the heap memory a container holds, including the strings and containers in its elements.
+struct ContainerEstimate {
+    std::string name;
+    size_t elements;
+    uint64_t bytes;
+};
+std::vector<ContainerEstimate> EstimateContainers(const std::unordered_map<std::string, File>& files,
+                                                  const std::unordered_map<std::string, Component *>& components,
+                                                  const std::unordered_map<std::string, std::string>& includeLookup,
+                                                  const std::map<std::string, std::set<std::string>>& collisions,
+                                                  const std::map<std::string, std::vector<std::string>>& ambiguous);
+
+// Called at the end of every stage to measure the containers of the program.
+void SetContainerSampler(const std::function<std::vector<ContainerEstimate>()>& sampler);
+
+// Records the heap use of a stage that started when the counters were at atStart, the resident set size
+// and the containers at its end.
+void RecordMemoryStage(const std::string& name, const HeapCounters& atStart);
+void PrintMemoryStats(std::ostream& out);
+
+#endif
+
+
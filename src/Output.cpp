@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 
+#include "Analysis.h"
 #include "Component.h"
 #include "Configuration.h"
+#include "Graph.h"
+#include "Input.h"
 #include <fstream>
 #include "Output.h"
-#include <cstring>
+#include "Snapshot.h"
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <stack>
 
 #ifndef _WIN32
@@ -45,6 +50,28 @@ static const std::string& getLinkColor(const Configuration& config, Component *a
     return config.privateDepColor;
 }
 
+static std::string getEdgeAttributes(const Configuration& config, Component *a, Component *b) {
+    std::string attributes = "[color=" + getLinkColor(config, a, b);
+    if (config.includeCountLabels) {
+        auto it = a->includeReasons.find(b);
+        const std::string count = std::to_string(it == a->includeReasons.end() ? 0 : it->second.size());
+        attributes += ", label=" + count + ", weight=" + count;
+    }
+    return attributes + "]";
+}
+
+static std::vector<std::pair<File *, File *>> SortedIncludeReasons(Component *a, Component *b) {
+    std::vector<std::pair<File *, File *>> reasons;
+    auto it = a->includeReasons.find(b);
+    if (it != a->includeReasons.end()) {
+        reasons = it->second;
+    }
+    std::sort(reasons.begin(), reasons.end(), [](const std::pair<File *, File *>& x, const std::pair<File *, File *>& y) {
+        return x.first->path < y.first->path || (x.first->path == y.first->path && x.second->path < y.second->path);
+    });
+    return reasons;
+}
+
 static const char* getShapeForSize(Component* c) {
     size_t loc = c->loc();
     if (loc < 1000) {
@@ -89,8 +116,8 @@ void OutputFlatDependencies(const Configuration& config, std::unordered_map<std:
             if (d->root.string().size() > 2 &&
                 d->files.size()) {
                 if (depcomps.insert(d).second) {
-                    out << "  " << c.second->QuotedName() << " -> " << d->QuotedName() << " [color="
-                        << getLinkColor(config, c.second, d) << "];" << '\n';
+                    out << "  " << c.second->QuotedName() << " -> " << d->QuotedName() << " "
+                        << getEdgeAttributes(config, c.second, d) << ";" << '\n';
                 }
             }
         }
@@ -98,8 +125,8 @@ void OutputFlatDependencies(const Configuration& config, std::unordered_map<std:
             if (d->root.string().size() > 2 &&
                 d->files.size()) {
                 if (depcomps.insert(d).second) {
-                    out << "  " << c.second->QuotedName() << " -> " << d->QuotedName() << " [color="
-                        << getLinkColor(config, c.second, d) << "];" << '\n';
+                    out << "  " << c.second->QuotedName() << " -> " << d->QuotedName() << " "
+                        << getEdgeAttributes(config, c.second, d) << ";" << '\n';
                 }
             }
         }
@@ -120,8 +147,8 @@ void OutputCircularDependencies(const Configuration& config, std::unordered_map<
         out << "  " << c.second->QuotedName() << " [shape=" << getShapeForSize(c.second) << "];\n";
 
         for (const auto &t : c.second->circulars) {
-            out << "  " << c.second->QuotedName() << " -> " << t->QuotedName() << " [color="
-                << getLinkColor(config, c.second, t) << "];" << '\n';
+            out << "  " << c.second->QuotedName() << " -> " << t->QuotedName() << " "
+                << getEdgeAttributes(config, c.second, t) << ";" << '\n';
         }
     }
     out << "}" << '\n';
@@ -151,8 +178,8 @@ void PrintGraphOnTarget(const Configuration& config, const std::filesystem::path
             if (d->root.string().size() > 2 &&
                 d->files.size()) {
                 if (depcomps.insert(d).second) {
-                    out << "  " << c2->QuotedName() << " -> " << d->QuotedName() << " [color=" << getLinkColor(config, c2, d)
-                        << "];" << '\n';
+                    out << "  " << c2->QuotedName() << " -> " << d->QuotedName() << " " << getEdgeAttributes(config, c2, d)
+                        << ";" << '\n';
                 }
                 if (comps.insert(d).second) {
                     todo.push(d);
@@ -163,8 +190,8 @@ void PrintGraphOnTarget(const Configuration& config, const std::filesystem::path
             if (d->root.string().size() > 2 &&
                 d->files.size()) {
                 if (depcomps.insert(d).second) {
-                    out << "  " << c2->QuotedName() << " -> " << d->QuotedName() << " [color=" << getLinkColor(config, c2, d)
-                        << "];" << '\n';
+                    out << "  " << c2->QuotedName() << " -> " << d->QuotedName() << " " << getEdgeAttributes(config, c2, d)
+                        << ";" << '\n';
                 }
                 if (comps.insert(d).second) {
                     todo.push(d);
@@ -236,6 +263,18 @@ void PrintInfoOnTarget(Component *c) {
     for (auto &d : sortedPrivDeps) {
         std::cout << ' ' << d;
     }
+    std::vector<std::string> sortedDeps(SortedNiceNames(c->pubDeps));
+    std::vector<std::string> sortedPriv(SortedNiceNames(c->privDeps));
+    sortedDeps.insert(sortedDeps.end(), sortedPriv.begin(), sortedPriv.end());
+    std::sort(sortedDeps.begin(), sortedDeps.end());
+    std::map<std::string, size_t> includeCounts;
+    for (auto &r : c->includeReasons) {
+        includeCounts[r.first->NiceName('.')] = r.second.size();
+    }
+    std::cout << "\nIncludes per dependency:";
+    for (auto &d : sortedDeps) {
+        std::cout << ' ' << d << '=' << includeCounts[d];
+    }
     std::cout << "\nBuild-afters:";
     for (auto &d : c->buildAfters) {
         std::cout << ' ' << d;
@@ -283,7 +322,137 @@ void PrintAllFiles(std::unordered_map<std::string, File>& files, const char* des
   std::cout << '\n';
 }
 
-void FindSpecificLink(const Configuration& config, std::unordered_map<std::string, File>& files, Component *from, Component *to) {
+static std::string GroupName(const std::vector<Component *>& group) {
+    if (group.size() == 1) {
+        return group[0]->NiceName('.');
+    }
+    std::string name = "{";
+    for (auto &c : group) {
+        if (name.size() > 1) name += ", ";
+        name += c->NiceName('.');
+    }
+    return name + "}";
+}
+
+void PrintBuildLevels(const BuildLevels& levels, const char* unit) {
+    std::vector<std::vector<std::string>> perLevel(levels.levelCount);
+    std::vector<size_t> componentCount(levels.levelCount, 0), weight(levels.levelCount, 0);
+    for (size_t g = 0; g < levels.groups.size(); g++) {
+        perLevel[levels.level[g]].push_back(GroupName(levels.groups[g]));
+        componentCount[levels.level[g]] += levels.groups[g].size();
+        weight[levels.level[g]] += levels.weight[g];
+    }
+    for (size_t l = 0; l < levels.levelCount; l++) {
+        std::sort(perLevel[l].begin(), perLevel[l].end());
+        std::cout << "Level " << l << " (" << componentCount[l] << " components, " << weight[l] << " " << unit << "):";
+        for (auto &name : perLevel[l]) {
+            std::cout << ' ' << name;
+        }
+        std::cout << '\n';
+    }
+    std::cout << "Critical path: " << levels.criticalWeight << " " << unit << " in " << levels.criticalPath.size() << " steps\n";
+}
+
+void PrintCriticalPath(const BuildLevels& levels, const char* unit) {
+    std::cout << "Critical path (" << levels.criticalWeight << " " << unit << "):\n";
+    for (auto &g : levels.criticalPath) {
+        std::cout << "  " << GroupName(levels.groups[g]) << " (" << levels.weight[g] << ")\n";
+    }
+    if (levels.splitGains.empty()) return;
+    std::cout << "Splitting these components shortens the critical path the most:\n";
+    for (auto &g : levels.splitGains) {
+        std::cout << "  " << GroupName(levels.groups[g.first]) << ": up to " << g.second << " " << unit << '\n';
+    }
+}
+
+void PrintSplitSuggestion(const Component& component, const SplitSuggestion& split) {
+    size_t cut = 0;
+    for (auto &row : split.crossIncludes) {
+        for (auto &count : row) cut += count;
+    }
+    std::cout << "Split of " << component.NiceName('.') << " (" << component.loc() << " LOC) into " << split.parts.size()
+              << " parts, cutting " << cut << " of " << split.internalIncludes << " includes:\n";
+    for (size_t p = 0; p < split.parts.size(); p++) {
+        std::cout << "Part " << p + 1 << " (" << split.partLoc[p] << " LOC, " << split.parts[p].size() << " files):\n";
+        for (auto &f : split.parts[p]) {
+            std::cout << "  " << f->path.string() << "\n";
+        }
+    }
+    for (size_t a = 0; a < split.parts.size(); a++) {
+        for (size_t b = 0; b < split.parts.size(); b++) {
+            if (split.crossIncludes[a][b] == 0) continue;
+            std::cout << "Part " << a + 1 << " includes part " << b + 1 << " " << split.crossIncludes[a][b] << " times";
+            if (a < b && split.crossIncludes[b][a]) std::cout << " (cyclic)";
+            std::cout << "\n";
+        }
+    }
+}
+
+void PrintMergeSuggestions(const std::vector<MergeSuggestion>& merges) {
+    for (auto &m : merges) {
+        std::cout << "Merge " << m.component->NiceName('.') << " (" << m.component->loc() << " LOC) into "
+                  << m.partner->NiceName('.') << " (" << m.partner->loc() << " LOC): " << m.includes << " includes between them";
+        if (m.createsCycle) std::cout << ", but they also depend on each other through other components";
+        std::cout << "\n";
+    }
+}
+
+static void PrintNames(const char* description, const std::vector<std::string>& names) {
+    if (names.empty()) return;
+    std::cout << description << "\n";
+    for (auto &n : names) {
+        std::cout << "  " << n << "\n";
+    }
+}
+
+static void PrintLinks(const char* description, const std::vector<std::pair<std::string, std::string>>& links) {
+    if (links.empty()) return;
+    std::cout << description << "\n";
+    for (auto &l : links) {
+        std::cout << "  " << l.first << " -> " << l.second << "\n";
+    }
+}
+
+void PrintSnapshotDiff(const SnapshotDiff& diff, size_t maxImpactChanges) {
+    PrintNames("Added components:", diff.addedComponents);
+    PrintNames("Removed components:", diff.removedComponents);
+    PrintLinks("Added dependencies:", diff.addedDependencies);
+    PrintLinks("Removed dependencies:", diff.removedDependencies);
+    PrintNames("Components that are now part of a cycle:", diff.newlyCyclic);
+    PrintNames("Components that are no longer part of a cycle:", diff.noLongerCyclic);
+    for (auto &c : diff.changedCycles) {
+        std::cout << "Cycle changed, now " << c.members.size() << " components:\n";
+        for (auto &m : c.joined) std::cout << "  + " << m << "\n";
+        for (auto &m : c.left) std::cout << "  - " << m << "\n";
+    }
+    std::cout << "Includes: " << diff.addedIncludes.size() << " added, " << diff.removedIncludes.size() << " removed\n";
+    std::cout << "Total include impact: " << diff.totalImpactBefore << " -> " << diff.totalImpactAfter << "\n";
+    for (size_t n = 0; n < diff.impactChanges.size() && n < maxImpactChanges; n++) {
+        auto &i = diff.impactChanges[n];
+        std::cout << "impact=" << i.second.first << "->" << i.second.second << " name=" << i.first << "\n";
+    }
+}
+
+void PrintBudgetViolations(const std::vector<BudgetViolation>& violations) {
+    for (auto &v : violations) {
+        switch (v.kind) {
+        case BudgetViolation::TotalImpact:
+            std::cout << "Total include impact grew from " << v.before << " to " << v.after << "\n";
+            break;
+        case BudgetViolation::Impact:
+            std::cout << "Include impact of " << v.name << " grew from " << v.before << " to " << v.after << "\n";
+            break;
+        case BudgetViolation::FanOut:
+            std::cout << "Component " << v.name << " grew from " << v.before << " to " << v.after << " dependencies\n";
+            break;
+        case BudgetViolation::Cycle:
+            std::cout << "Component " << v.name << " became part of a cycle\n";
+            break;
+        }
+    }
+}
+
+void FindSpecificLink(const Configuration& config, Component *from, Component *to) {
     std::unordered_map<Component *, Component *> parents;
     std::unordered_set<Component *> alreadyHad;
     std::deque<Component *> tocheck;
@@ -313,14 +482,8 @@ void FindSpecificLink(const Configuration& config, std::unordered_map<std::strin
                     }
                     std::cout << p->NiceName('.') << " -> " << c2->NiceName('.') << '\n';
                     std::cout << CURSES_RESET_COLOR;
-                    for (auto &f : files) {
-                        if (f.second.component == p) {
-                            for (auto &f2 : f.second.dependencies) {
-                                if (f2->component == c2) {
-                                    std::cout << "  " << f.second.path.string() << " includes " << f2->path.string() << '\n';
-                                }
-                            }
-                        }
+                    for (auto &r : SortedIncludeReasons(p, c2)) {
+                        std::cout << "  " << r.first->path.string() << " includes " << r.second->path.string() << '\n';
                     }
                     p = c2;
                 }
@@ -346,67 +509,154 @@ void FindSpecificLink(const Configuration& config, std::unordered_map<std::strin
     std::cout << "No path could be found from " << from->NiceName('.') << " to " << to->NiceName('.') << '\n';
 }
 
-static void UpdateIncludeFor(std::unordered_map<std::string, File>& files, std::unordered_map<std::string, std::string> &includeLookup, File* from, Component* comp, const std::string& desiredPath, bool isAbsolute) {
-    std::filesystem::path newName = from->path.generic_string() + ".new";
-    {
-        std::ifstream in(from->path);
-        std::ofstream out(newName.generic_string().c_str());
-        while (in.good()) {
-            bool isReplacement = false;
-            std::string line;
-            std::getline(in, line);
-            const char* l = strstr(line.c_str(), "#");
-            if (l && (l = strstr(l, "include"))) {
-                const char* start = strstr(l, "<");
-                const char* end;
-                if (start) {
-                    end = strstr(start + 1, ">");
-                } else {
-                    start = strstr(l, "\"");
-                    end = start ? strstr(start+1, "\"") : nullptr;
-                }
-                if (start && end) {
-                    std::string includePath(start+1, end);
-                    std::string lowerPath;
-                    std::transform(includePath.begin(), includePath.end(), std::back_inserter(lowerPath), ::tolower);
-                    std::string postLookup = includeLookup[lowerPath];
-                    if (!postLookup.empty() && postLookup != "INVALID" && files.find(postLookup) != files.end()) {
-                        File* f = &files.find(postLookup)->second;
-                        std::string path = f->path.generic_string();
-                        std::string pathToStrip = (isAbsolute ? "." : comp->root.generic_string()) + "/";
-                        if (desiredPath != ".") pathToStrip += desiredPath + "/";
-                        std::string newInclude = path.substr(pathToStrip.size());
-                        std::string componentPath = comp->root.generic_string();
-                        // Don't make an include ambiguous by doing this change
-                        if (includeLookup[newInclude] != "INVALID" && path.compare(0, componentPath.size(), componentPath) == 0 && path.compare(0, pathToStrip.size(), pathToStrip) == 0) {
-                            isReplacement = true;
-                            if (from->component == f->component) {
-                                out << "#include \"" + newInclude + "\"\n";
-                            } else {
-                                out << "#include <" + newInclude + ">\n";
-                            }
-                        }
-                    }
-                }
-            }
-            if (!isReplacement) {
-                out << line << '\n';
+// The include path for a header in a relocated component, or an empty string if the header is not below
+// the desired path.
+static std::string RelocatedInclude(const IncludeRelocation& relocation, const File& header) {
+    std::string path = header.path.generic_string();
+    std::string pathToStrip = (relocation.isAbsolute ? "." : relocation.component->root.generic_string()) + "/";
+    if (relocation.desiredPath != ".") pathToStrip += relocation.desiredPath + "/";
+    if (path.compare(0, pathToStrip.size(), pathToStrip) != 0) return "";
+    return path.substr(pathToStrip.size());
+}
+
+static void SplitLines(const std::string& text, std::vector<std::string>& lines) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// A unified diff with three lines of context. Rewriting includes keeps every line where it was, so
+// old and new have the same lines apart from the changed ones.
+static std::string UnifiedDiff(const std::string& name, const std::string& oldText, const std::string& newText) {
+    std::vector<std::string> oldLines, newLines;
+    SplitLines(oldText, oldLines);
+    SplitLines(newText, newLines);
+    const size_t count = std::min(oldLines.size(), newLines.size()), context = 3;
+    std::ostringstream o;
+    o << "--- a/" << name << "\n+++ b/" << name << "\n";
+    size_t line = 0;
+    while (line < count) {
+        if (oldLines[line] == newLines[line]) {
+            line++;
+            continue;
+        }
+        // Extend the hunk for as long as the next change is within reach of the context.
+        size_t first = line >= context ? line - context : 0, last = line;
+        for (size_t n = line + 1; n < count && n <= last + 2 * context; n++) {
+            if (oldLines[n] != newLines[n]) last = n;
+        }
+        const size_t end = std::min(count, last + context + 1);
+        o << "@@ -" << first + 1 << "," << end - first << " +" << first + 1 << "," << end - first << " @@\n";
+        for (size_t n = first; n < end; n++) {
+            if (oldLines[n] == newLines[n]) {
+                o << " " << oldLines[n] << "\n";
+            } else {
+                o << "-" << oldLines[n] << "\n" << "+" << newLines[n] << "\n";
             }
         }
+        line = end;
     }
-    std::filesystem::rename(newName, from->path);
+    return o.str();
 }
 
-void UpdateIncludes(std::unordered_map<std::string, File>& files, std::unordered_map<std::string, std::string> &includeLookup, Component* component, const std::string& desiredPath, bool isAbsolute) {
-    for (auto& p : files) {
-        for (auto& d : p.second.dependencies) {
-            if (component->files.find(d) != component->files.end()) {
-                UpdateIncludeFor(files, includeLookup, &p.second, component, desiredPath, isAbsolute);
-                std::cout << p.second.path.generic_string() << "\n";
-                break;
+// Whether include names more than one header, as opposed to none, going by the lookup table ResolveInclude uses.
+static bool IsAmbiguousInclude(const std::unordered_map<std::string, std::string> &includeLookup, const std::string& include) {
+    std::string lowercaseInclude;
+    std::transform(include.begin(), include.end(), std::back_inserter(lowercaseInclude), ::tolower);
+    auto it = includeLookup.find(lowercaseInclude);
+    return it != includeLookup.end() && it->second == "INVALID";
+}
+
+void UpdateIncludes(std::unordered_map<std::string, File>& files,
+                    const std::unordered_map<std::string, std::string> &includeLookup,
+                    const std::vector<IncludeRelocation>& plan, bool dryRun) {
+    std::unordered_map<const Component *, const IncludeRelocation *> relocations;
+    std::unordered_set<File *> users;
+    for (auto& relocation : plan) {
+        relocations[relocation.component] = &relocation;
+        for (auto& f : relocation.component->files) {
+            users.insert(f->includedBy.begin(), f->includedBy.end());
+        }
+    }
+    std::vector<File *> sortedUsers(users.begin(), users.end());
+    std::sort(sortedUsers.begin(), sortedUsers.end(), [](const File* a, const File* b) { return a->path < b->path; });
+    std::vector<std::string> reports(sortedUsers.size());
+    ParallelFor(sortedUsers.size(), [&](size_t index, size_t) {
+        const File* from = sortedUsers[index];
+        const std::string name = from->path.lexically_normal().generic_string();
+        std::string content;
+        {
+            std::ifstream in(from->path, std::ios::binary);
+            if (!in) {
+                reports[index] = "Cannot read " + name + "\n";
+                return;
             }
+            std::ostringstream buffer;
+            buffer << in.rdbuf();
+            content = buffer.str();
         }
+        // Only the path and its quotes or brackets are replaced, so the rest of the line stays as it is.
+        std::string rewritten, problems;
+        size_t copied = 0;
+        ScanIncludeStatements(content.data(), content.size(), [&](bool withPointyBrackets, size_t start, size_t end) {
+            const std::string include = content.substr(start, end - start);
+            File* header = ResolveInclude(files, includeLookup, *from, include, withPointyBrackets);
+            if (!header) return;
+            auto relocation = relocations.find(header->component);
+            if (relocation == relocations.end()) return;
+            std::string newInclude = RelocatedInclude(*relocation->second, *header);
+            bool newPointyBrackets = from->component != header->component;
+            if (newInclude.empty() || (newInclude == include && newPointyBrackets == withPointyBrackets)) return;
+            // The new spelling has to find the same header, also when the includes of all other relocations
+            // are taken into account; those only change spellings, so resolving it against the same files does.
+            File* found = ResolveInclude(files, includeLookup, *from, newInclude, newPointyBrackets);
+            if (found != header) {
+                problems += "Not changing " + include + " in " + name + ": " + newInclude +
+                            (found ? " would include " + found->path.generic_string()
+                                   : IsAmbiguousInclude(includeLookup, newInclude) ? " would be ambiguous" : " would not be found") + "\n";
+                return;
+            }
+            rewritten.append(content, copied, start - 1 - copied);
+            rewritten += newPointyBrackets ? '<' : '"';
+            rewritten += newInclude;
+            rewritten += newPointyBrackets ? '>' : '"';
+            copied = end + 1;
+        });
+        rewritten.append(content, copied, std::string::npos);
+        reports[index] = problems;
+        if (rewritten == content) return;
+
+        if (dryRun) {
+            reports[index] += UnifiedDiff(name, content, rewritten);
+            return;
+        }
+        std::error_code ec;
+        ReplaceFile(from->path, from->path.generic_string() + ".new", rewritten, true, ec);
+        reports[index] += ec ? "Cannot update " + name + ": " + ec.message() + "\n" : from->path.generic_string() + "\n";
+    });
+    for (auto& report : reports) {
+        std::cout << report;
     }
 }
 
-
+bool ReplaceFile(const std::filesystem::path& path, const std::filesystem::path& temporary, const std::string& contents,
+                 bool binary, std::error_code& ec) {
+    ec.clear();
+    {
+        std::ofstream out(temporary, binary ? std::ios::out | std::ios::binary : std::ios::out);
+        out << contents;
+        out.close();
+        if (!out) ec = std::make_error_code(std::errc::io_error);
+    }
+    if (!ec) std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        return false;
+    }
+    return true;
+}
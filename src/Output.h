@@ -19,9 +19,16 @@
 
 #include <filesystem>
 #include <functional>
+#include <string>
+#include <system_error>
 #include <unordered_set>
 #include <vector>
 
+struct BudgetViolation;
+struct BuildLevels;
+struct MergeSuggestion;
+struct SnapshotDiff;
+struct SplitSuggestion;
 struct Component;
 
 void OutputFlatDependencies(const Configuration& config, std::unordered_map<std::string, Component *> &components,
@@ -38,8 +45,32 @@ void FindAndPrintCycleFrom(Component *origin, Component *c, std::unordered_set<C
 void PrintCyclesForTarget(Component *c);
 void PrintLinksForTarget(Component *c);
 void PrintInfoOnTarget(Component *c);
-void FindSpecificLink(const Configuration& config, std::unordered_map<std::string, File>& files, Component *from, Component *to);
-void UpdateIncludes(std::unordered_map<std::string, File>& files, std::unordered_map<std::string, std::string> &includeLookup, Component* component, const std::string& desiredPath, bool isAbsolute);
+void PrintBuildLevels(const BuildLevels& levels, const char* unit);
+void PrintCriticalPath(const BuildLevels& levels, const char* unit);
+void PrintSplitSuggestion(const Component& component, const SplitSuggestion& split);
+void PrintMergeSuggestions(const std::vector<MergeSuggestion>& merges);
+void PrintSnapshotDiff(const SnapshotDiff& diff, size_t maxImpactChanges);
+void PrintBudgetViolations(const std::vector<BudgetViolation>& violations);
+void FindSpecificLink(const Configuration& config, Component *from, Component *to);
+// Including the headers of component relative to desiredPath, which is relative to the root of the
+// project if isAbsolute and to the root of the component otherwise.
+struct IncludeRelocation {
+    Component* component;
+    std::string desiredPath;
+    bool isAbsolute;
+};
+
+// Rewrites the includes of the headers of all components in the plan, reading and writing every file that
+// uses them once and only if its text changes. An include is left as it is if its new spelling would not
+// find the same header. With dryRun, prints a unified diff instead.
+void UpdateIncludes(std::unordered_map<std::string, File>& files,
+                    const std::unordered_map<std::string, std::string> &includeLookup,
+                    const std::vector<IncludeRelocation>& plan, bool dryRun);
+
+// Writes contents to temporary, next to path, and renames it over path, so that a failed or interrupted write
+// never leaves half a file. On failure, path is left as it was, temporary is removed and ec holds the reason.
+bool ReplaceFile(const std::filesystem::path& path, const std::filesystem::path& temporary, const std::string& contents,
+                 bool binary, std::error_code& ec);
 
 #endif
 
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Partition.h"
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <random>
+
+// Coarsening stops at this many nodes; the initial bisection is done on a graph of about this size.
+static const size_t coarsestSize = 64;
+
+static WeightedGraph MakeFromEdgeList(std::vector<uint64_t> nodeWeight, std::vector<std::pair<std::pair<size_t, size_t>, uint64_t>> edgeList) {
+    std::sort(edgeList.begin(), edgeList.end());
+    WeightedGraph g;
+    g.nodeWeight = std::move(nodeWeight);
+    g.edgeStart.assign(g.size() + 1, 0);
+    for (size_t n = 0; n < edgeList.size(); n++) {
+        if (n > 0 && edgeList[n].first == edgeList[n - 1].first) {
+            g.edgeWeight.back() += edgeList[n].second;
+            continue;
+        }
+        g.edgeStart[edgeList[n].first.first + 1]++;
+        g.neighbours.push_back(edgeList[n].first.second);
+        g.edgeWeight.push_back(edgeList[n].second);
+    }
+    for (size_t n = 0; n < g.size(); n++) {
+        g.edgeStart[n + 1] += g.edgeStart[n];
+    }
+    return g;
+}
+
+WeightedGraph MakeWeightedGraph(const Digraph& g, std::vector<uint64_t> nodeWeight) {
+    std::vector<std::pair<std::pair<size_t, size_t>, uint64_t>> edgeList;
+    for (size_t n = 0; n < g.size(); n++) {
+        for (const size_t* it = g.begin(n); it != g.end(n); ++it) {
+            if (*it == n) continue;
+            edgeList.push_back(std::make_pair(std::make_pair(n, *it), 1));
+            edgeList.push_back(std::make_pair(std::make_pair(*it, n), 1));
+        }
+    }
+    return MakeFromEdgeList(std::move(nodeWeight), std::move(edgeList));
+}
+
+uint64_t CutWeight(const WeightedGraph& g, const std::vector<size_t>& part) {
+    uint64_t cut = 0;
+    for (size_t n = 0; n < g.size(); n++) {
+        for (size_t e = g.edgeStart[n]; e < g.edgeStart[n + 1]; e++) {
+            if (part[n] != part[g.neighbours[e]]) cut += g.edgeWeight[e];
+        }
+    }
+    return cut / 2;
+}
+
+// Collapses a heavy edge matching into a smaller graph. Returns false if that hardly shrinks the graph.
+static bool Coarsen(const WeightedGraph& g, uint64_t maxNodeWeight, std::mt19937& random,
+                    WeightedGraph& coarse, std::vector<size_t>& coarseOf) {
+    const size_t n = g.size(), unmatched = static_cast<size_t>(-1);
+    std::vector<size_t> order(n), match(n, unmatched);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), random);
+    coarseOf.assign(n, 0);
+    std::vector<uint64_t> coarseWeight;
+    for (auto& v : order) {
+        if (match[v] != unmatched) continue;
+        size_t best = v;
+        uint64_t bestWeight = 0;
+        for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+            const size_t u = g.neighbours[e];
+            if (match[u] != unmatched || g.nodeWeight[u] + g.nodeWeight[v] > maxNodeWeight) continue;
+            if (g.edgeWeight[e] > bestWeight) {
+                best = u;
+                bestWeight = g.edgeWeight[e];
+            }
+        }
+        match[v] = best;
+        match[best] = v;
+        coarseOf[v] = coarseOf[best] = coarseWeight.size();
+        coarseWeight.push_back(g.nodeWeight[v] + (best != v ? g.nodeWeight[best] : 0));
+    }
+    if (coarseWeight.size() * 20 > n * 19) return false;
+
+    std::vector<std::pair<std::pair<size_t, size_t>, uint64_t>> edgeList;
+    for (size_t v = 0; v < n; v++) {
+        for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+            if (coarseOf[v] != coarseOf[g.neighbours[e]]) {
+                edgeList.push_back(std::make_pair(std::make_pair(coarseOf[v], coarseOf[g.neighbours[e]]), g.edgeWeight[e]));
+            }
+        }
+    }
+    coarse = MakeFromEdgeList(std::move(coarseWeight), std::move(edgeList));
+    return true;
+}
+
+namespace {
+
+// The allowed weight range of side 0 when it should get the given fraction of the total weight.
+struct Balance {
+    uint64_t low, high;
+    Balance(const WeightedGraph& g, double fraction) {
+        const uint64_t total = std::accumulate(g.nodeWeight.begin(), g.nodeWeight.end(), uint64_t(0));
+        const uint64_t heaviest = g.size() ? *std::max_element(g.nodeWeight.begin(), g.nodeWeight.end()) : 0;
+        const uint64_t target = uint64_t(total * fraction);
+        const uint64_t tolerance = std::max<uint64_t>(total * 3 / 100, heaviest / 2);
+        low = target > tolerance ? target - tolerance : 0;
+        high = target + tolerance;
+    }
+    uint64_t Violation(uint64_t weight) const {
+        return weight < low ? low - weight : (weight > high ? weight - high : 0);
+    }
+};
+
+}
+
+// Fiduccia-Mattheyses: move nodes one at a time by best gain, even if that makes the cut worse,
+// and keep the best prefix of the moves. Being within balance always wins over a smaller cut.
+static uint64_t Refine(const WeightedGraph& g, const Balance& balance, std::vector<uint8_t>& side) {
+    const size_t n = g.size();
+    uint64_t weight0 = 0;
+    int64_t cut = 0;
+    for (size_t v = 0; v < n; v++) {
+        if (side[v] == 0) weight0 += g.nodeWeight[v];
+        for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+            if (side[v] != side[g.neighbours[e]]) cut += g.edgeWeight[e];
+        }
+    }
+    cut /= 2;
+    std::vector<int64_t> gain(n);
+    std::vector<bool> locked(n);
+    std::vector<size_t> moves;
+    for (size_t pass = 0; pass < 10; pass++) {
+        std::priority_queue<std::pair<int64_t, size_t>> heap;
+        for (size_t v = 0; v < n; v++) {
+            gain[v] = 0;
+            for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+                gain[v] += side[v] != side[g.neighbours[e]] ? int64_t(g.edgeWeight[e]) : -int64_t(g.edgeWeight[e]);
+            }
+            heap.push(std::make_pair(gain[v], v));
+        }
+        std::fill(locked.begin(), locked.end(), false);
+        moves.clear();
+        std::pair<uint64_t, int64_t> best(balance.Violation(weight0), cut);
+        size_t bestMoves = 0;
+        const size_t patience = std::max<size_t>(50, n / 20);
+        while (!heap.empty() && moves.size() - bestMoves < patience) {
+            const size_t v = heap.top().second;
+            const int64_t topGain = heap.top().first;
+            heap.pop();
+            if (locked[v] || topGain != gain[v]) continue;
+            const uint64_t newWeight0 = side[v] == 0 ? weight0 - g.nodeWeight[v] : weight0 + g.nodeWeight[v];
+            if (balance.Violation(newWeight0) > 0 && balance.Violation(newWeight0) >= balance.Violation(weight0)) continue;
+            side[v] ^= 1;
+            weight0 = newWeight0;
+            cut -= gain[v];
+            locked[v] = true;
+            moves.push_back(v);
+            for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+                const size_t u = g.neighbours[e];
+                gain[u] += side[u] == side[v] ? -2 * int64_t(g.edgeWeight[e]) : 2 * int64_t(g.edgeWeight[e]);
+                if (!locked[u]) heap.push(std::make_pair(gain[u], u));
+            }
+            std::pair<uint64_t, int64_t> now(balance.Violation(weight0), cut);
+            if (now < best) {
+                best = now;
+                bestMoves = moves.size();
+            }
+        }
+        while (moves.size() > bestMoves) {
+            const size_t v = moves.back();
+            moves.pop_back();
+            side[v] ^= 1;
+            weight0 = side[v] == 0 ? weight0 + g.nodeWeight[v] : weight0 - g.nodeWeight[v];
+        }
+        cut = best.second;
+        if (bestMoves == 0) break;
+    }
+    return uint64_t(cut);
+}
+
+// Greedy graph growing: starting from a seed, keep adding the node most connected to side 0
+// until side 0 has its share of the weight.
+static void GrowBisection(const WeightedGraph& g, const Balance& balance, size_t seed, std::vector<uint8_t>& side) {
+    const size_t n = g.size();
+    side.assign(n, 1);
+    std::vector<int64_t> gain(n, 0);
+    std::priority_queue<std::pair<int64_t, size_t>> frontier;
+    uint64_t weight0 = 0;
+    size_t nextUnused = 0;
+    frontier.push(std::make_pair(0, seed));
+    while (weight0 < balance.low) {
+        if (frontier.empty()) {
+            // Disconnected graph; continue from any node still on side 1.
+            while (nextUnused < n && side[nextUnused] == 0) nextUnused++;
+            if (nextUnused == n) break;
+            frontier.push(std::make_pair(gain[nextUnused], nextUnused));
+        }
+        const size_t v = frontier.top().second;
+        const int64_t topGain = frontier.top().first;
+        frontier.pop();
+        if (side[v] == 0 || topGain != gain[v]) continue;
+        side[v] = 0;
+        weight0 += g.nodeWeight[v];
+        for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+            const size_t u = g.neighbours[e];
+            gain[u] += 2 * int64_t(g.edgeWeight[e]);
+            if (side[u] == 1) frontier.push(std::make_pair(gain[u], u));
+        }
+    }
+}
+
+static std::vector<uint8_t> Bisect(const WeightedGraph& g, double fraction, std::mt19937& random) {
+    // Coarsen, remembering every level for the way back.
+    const uint64_t total = std::accumulate(g.nodeWeight.begin(), g.nodeWeight.end(), uint64_t(0));
+    const uint64_t maxNodeWeight = std::max<uint64_t>(1, total * 3 / (2 * coarsestSize));
+    std::vector<WeightedGraph> levels;
+    std::vector<std::vector<size_t>> coarseOf;
+    const WeightedGraph* current = &g;
+    while (current->size() > coarsestSize) {
+        WeightedGraph coarse;
+        std::vector<size_t> map;
+        if (!Coarsen(*current, maxNodeWeight, random, coarse, map)) break;
+        levels.push_back(std::move(coarse));
+        coarseOf.push_back(std::move(map));
+        current = &levels.back();
+    }
+
+    // Several tries of greedy growing on the coarsest graph, keeping the best after refinement.
+    std::vector<uint8_t> side, attempt;
+    std::pair<uint64_t, uint64_t> best(static_cast<uint64_t>(-1), 0);
+    const Balance coarsest(*current, fraction);
+    for (size_t tryCount = 0; tryCount < 8 && current->size() > 0; tryCount++) {
+        GrowBisection(*current, coarsest, random() % current->size(), attempt);
+        const uint64_t cut = Refine(*current, coarsest, attempt);
+        uint64_t weight0 = 0;
+        for (size_t v = 0; v < current->size(); v++) {
+            if (attempt[v] == 0) weight0 += current->nodeWeight[v];
+        }
+        std::pair<uint64_t, uint64_t> score(coarsest.Violation(weight0), cut);
+        if (score < best) {
+            best = score;
+            side = attempt;
+        }
+    }
+
+    // Project back level by level, refining on every level.
+    for (size_t level = levels.size(); level-- > 0;) {
+        const WeightedGraph& fine = level == 0 ? g : levels[level - 1];
+        std::vector<uint8_t> fineSide(fine.size());
+        for (size_t v = 0; v < fine.size(); v++) {
+            fineSide[v] = side[coarseOf[level][v]];
+        }
+        side.swap(fineSide);
+        Refine(fine, Balance(fine, fraction), side);
+    }
+    return side;
+}
+
+static void PartitionRecursive(const WeightedGraph& g, const std::vector<size_t>& nodes, size_t parts, size_t firstPart,
+                               std::vector<size_t>& result, std::mt19937& random) {
+    if (parts <= 1 || g.size() <= 1) {
+        for (auto& node : nodes) result[node] = firstPart;
+        return;
+    }
+    const size_t leftParts = parts / 2;
+    std::vector<uint8_t> side = Bisect(g, double(leftParts) / parts, random);
+    for (uint8_t s = 0; s < 2; s++) {
+        std::vector<size_t> local(g.size(), 0), subNodes;
+        std::vector<uint64_t> weights;
+        for (size_t v = 0; v < g.size(); v++) {
+            if (side[v] != s) continue;
+            local[v] = subNodes.size();
+            subNodes.push_back(nodes[v]);
+            weights.push_back(g.nodeWeight[v]);
+        }
+        std::vector<std::pair<std::pair<size_t, size_t>, uint64_t>> edgeList;
+        for (size_t v = 0; v < g.size(); v++) {
+            if (side[v] != s) continue;
+            for (size_t e = g.edgeStart[v]; e < g.edgeStart[v + 1]; e++) {
+                if (side[g.neighbours[e]] == s) {
+                    edgeList.push_back(std::make_pair(std::make_pair(local[v], local[g.neighbours[e]]), g.edgeWeight[e]));
+                }
+            }
+        }
+        PartitionRecursive(MakeFromEdgeList(std::move(weights), std::move(edgeList)), subNodes,
+                           s == 0 ? leftParts : parts - leftParts, s == 0 ? firstPart : firstPart + leftParts, result, random);
+    }
+}
+
+std::vector<size_t> PartitionGraph(const WeightedGraph& g, size_t parts) {
+    std::vector<size_t> result(g.size(), 0), nodes(g.size());
+    std::iota(nodes.begin(), nodes.end(), 0);
+    std::mt19937 random(12345);
+    PartitionRecursive(g, nodes, parts, 0, result, random);
+    return result;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__PARTITION_H
+#define __DEP_CHECKER__PARTITION_H
+
+#include "Graph.h"
+
+// Undirected graph with weighted nodes and edges. Every edge is stored in both directions,
+// the neighbours of node n are neighbours[edgeStart[n]] up to neighbours[edgeStart[n+1]].
+struct WeightedGraph {
+    std::vector<uint64_t> nodeWeight;
+    std::vector<size_t> edgeStart;
+    std::vector<size_t> neighbours;
+    std::vector<uint64_t> edgeWeight;
+    size_t size() const { return nodeWeight.size(); }
+};
+
+// Makes an undirected graph out of a directed one. Edges in both directions between two
+// nodes are merged into one edge with weight 2; self loops are dropped.
+WeightedGraph MakeWeightedGraph(const Digraph& g, std::vector<uint64_t> nodeWeight);
+
+// Splits the nodes into the given number of parts of about equal node weight, with as little
+// edge weight between the parts as possible. Uses recursive multilevel bisection: the graph is
+// coarsened by heavy edge matching, bisected by greedy growing and then refined with
+// Fiduccia-Mattheyses passes at every level on the way back. Returns the part of every node.
+std::vector<size_t> PartitionGraph(const WeightedGraph& g, size_t parts);
+
+// Total weight of the edges between different parts.
+uint64_t CutWeight(const WeightedGraph& g, const std::vector<size_t>& part);
+
+#endif
+
+
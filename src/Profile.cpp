@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace {
+
+struct ProfileSpan {
+    std::string name;
+    int64_t start, duration;
+    size_t thread;
+};
+
+struct ProfileTotal {
+    uint64_t calls = 0;
+    int64_t firstStart = 0, duration = 0;
+};
+
+struct ProfileState {
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::vector<ProfileSpan> spans;
+    std::map<std::string, ProfileTotal> totals;
+    std::map<std::string, uint64_t> counters;
+};
+
+std::atomic<bool> enabled(false);
+// Spans go on one trace track per ParallelFor worker, rather than per thread, so that a run starting
+// many parallel loops does not end up with a track for every thread it ever started. The main thread,
+// and anything not run by a worker, is track 0.
+std::atomic<size_t> trackCount(1);
+thread_local size_t currentTrack = 0;
+thread_local std::vector<std::string> stageStack;
+
+ProfileState& State() {
+    static ProfileState state;
+    return state;
+}
+
+int64_t Microseconds(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - State().origin).count();
+}
+
+std::string JsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out + "\"";
+}
+
+}
+
+void EnableProfiling() {
+    State();
+    enabled = true;
+}
+
+bool ProfilingEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+ProfileScope::ProfileScope(const std::string& name, Kind kind, size_t worker)
+: active(ProfilingEnabled() || (kind == Stage && MemoryStatsEnabled()))
+, kind(kind)
+, previousTrack(currentTrack)
+{
+    if (!active) return;
+    this->name = name;
+    if (kind == Worker) {
+        currentTrack = worker + 1;
+        size_t tracks = trackCount;
+        while (tracks <= currentTrack && !trackCount.compare_exchange_weak(tracks, currentTrack + 1)) {}
+    }
+    if (kind == Stage) stageStack.push_back(name);
+    heapAtStart = ReadHeapCounters();
+    start = std::chrono::steady_clock::now();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!active) return;
+    const auto end = std::chrono::steady_clock::now();
+    if (kind == Stage) stageStack.pop_back();
+    if (kind == Stage && MemoryStatsEnabled()) RecordMemoryStage(name, heapAtStart);
+    if (!ProfilingEnabled()) {
+        if (kind == Worker) currentTrack = previousTrack;
+        return;
+    }
+    ProfileState& state = State();
+    const int64_t begin = Microseconds(start), duration = Microseconds(end) - begin;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (kind != Worker) {
+        ProfileTotal& total = state.totals[name];
+        if (total.calls++ == 0) total.firstStart = begin;
+        total.duration += duration;
+    }
+    if (kind != Detail) {
+        state.spans.push_back(ProfileSpan{ name, begin, duration, currentTrack });
+    }
+    if (kind == Worker) currentTrack = previousTrack;
+}
+
+std::string CurrentProfileStage() {
+    return stageStack.empty() ? std::string() : stageStack.back();
+}
+
+void CountProfile(const char* name, uint64_t amount) {
+    if (!ProfilingEnabled()) return;
+    ProfileState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.counters[name] += amount;
+}
+
+void SetProfileValue(const char* name, uint64_t value) {
+    if (!ProfilingEnabled()) return;
+    ProfileState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.counters[name] = value;
+}
+
+void PrintProfile(std::ostream& out) {
+    ProfileState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::vector<std::pair<std::string, ProfileTotal>> totals(state.totals.begin(), state.totals.end());
+    std::stable_sort(totals.begin(), totals.end(), [](const std::pair<std::string, ProfileTotal>& a, const std::pair<std::string, ProfileTotal>& b) {
+        return a.second.firstStart < b.second.firstStart;
+    });
+    size_t width = 5;
+    for (auto& t : totals) width = std::max(width, t.first.size());
+    for (auto& c : state.counters) width = std::max(width, c.first.size());
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "\nProfile:\n";
+    out << "  " << std::left << std::setw(width) << "Stage" << std::right << std::setw(10) << "calls" << std::setw(12) << "ms" << "\n";
+    for (auto& t : totals) {
+        out << "  " << std::left << std::setw(width) << t.first << std::right << std::setw(10) << t.second.calls
+            << std::setw(12) << std::fixed << std::setprecision(1) << t.second.duration / 1000.0 << "\n";
+    }
+    if (!state.counters.empty()) {
+        out << "\n";
+        for (auto& c : state.counters) {
+            out << "  " << std::left << std::setw(width) << c.first << std::right << std::setw(22) << c.second << "\n";
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void WriteChromeTrace(std::ostream& out) {
+    ProfileState& state = State();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    out << "{\"traceEvents\":[\n";
+    const size_t threads = trackCount;
+    for (size_t thread = 0; thread < threads; thread++) {
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":" << JsonString(thread ? "worker " + std::to_string(thread - 1) : "main") << "}},\n";
+    }
+    int64_t end = 0;
+    for (auto& span : state.spans) {
+        out << "{\"name\":" << JsonString(span.name) << ",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+            << ",\"ts\":" << span.start << ",\"dur\":" << span.duration << "},\n";
+        end = std::max(end, span.start + span.duration);
+    }
+    out << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << end << ",\"args\":{";
+    const char* separator = "";
+    for (auto& c : state.counters) {
+        out << separator << JsonString(c.first) << ":" << c.second;
+        separator = ",";
+    }
+    out << "}}\n]}\n";
+}
+
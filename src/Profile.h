@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__PROFILE_H
+#define __DEP_CHECKER__PROFILE_H
+
+#include "MemoryStats.h"
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Timing and counting of the stages of a run for --profile. Everything here does nothing until
+// EnableProfiling is called, apart from checking whether it was.
+void EnableProfiling();
+bool ProfilingEnabled();
+
+// Times the scope it lives in. Stages show up in the summary and in the trace, details only add to
+// the summary (for scopes entered far too often to trace), and worker spans only show up in the
+// trace, as the part of a stage that one thread of a parallel loop ran. Worker spans, and the spans
+// inside them, go on the trace track of their worker index. With --memstats, stages also record the
+// memory they used.
+class ProfileScope {
+public:
+    enum Kind { Stage, Detail, Worker };
+    explicit ProfileScope(const std::string& name, Kind kind = Stage, size_t worker = 0);
+    ~ProfileScope();
+private:
+    bool active;
+    Kind kind;
+    size_t previousTrack;
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    HeapCounters heapAtStart;
+};
+
+// The innermost stage running on this thread, or an empty string.
+std::string CurrentProfileStage();
+
+// Adds to a counter, or sets it to a value such as the size of a table.
+void CountProfile(const char* name, uint64_t amount);
+void SetProfileValue(const char* name, uint64_t value);
+
+// Prints the time spent per stage and all counters.
+void PrintProfile(std::ostream& out);
+// Writes all spans and counters in the Chrome trace event format, as read by chrome://tracing and Perfetto.
+void WriteChromeTrace(std::ostream& out);
+
+#endif
+
+
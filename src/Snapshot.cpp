@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Snapshot.h"
+#include "Component.h"
+#include "Configuration.h"
+#include "Graph.h"
+#include <algorithm>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+
+static const char snapshotHeader[] = "cpp-dependencies snapshot 1";
+
+Snapshot MakeSnapshot(std::unordered_map<std::string, Component *> &components,
+                      std::unordered_map<std::string, File> &files) {
+    Snapshot s;
+    std::vector<std::pair<std::string, Component *>> sortedComponents;
+    for (auto &c : components) {
+        if (c.second) sortedComponents.push_back(std::make_pair(c.second->NiceName('.'), c.second));
+    }
+    std::sort(sortedComponents.begin(), sortedComponents.end());
+    std::unordered_map<Component *, size_t> componentIndex;
+    for (auto &c : sortedComponents) {
+        componentIndex[c.second] = s.components.size();
+        s.components.push_back(c.first);
+    }
+    for (auto &c : sortedComponents) {
+        for (auto &deps : { &c.second->pubDeps, &c.second->privDeps }) {
+            for (auto &d : *deps) {
+                auto it = componentIndex.find(d);
+                if (it != componentIndex.end()) s.componentEdges.push_back(std::make_pair(componentIndex[c.second], it->second));
+            }
+        }
+    }
+    std::sort(s.componentEdges.begin(), s.componentEdges.end());
+    s.componentEdges.erase(std::unique(s.componentEdges.begin(), s.componentEdges.end()), s.componentEdges.end());
+
+    std::vector<std::pair<std::string, File *>> sortedFiles;
+    for (auto &f : files) {
+        sortedFiles.push_back(std::make_pair(f.second.path.generic_string(), &f.second));
+    }
+    std::sort(sortedFiles.begin(), sortedFiles.end());
+    std::unordered_map<File *, size_t> fileIndex;
+    for (auto &f : sortedFiles) {
+        fileIndex[f.second] = s.files.size();
+        s.files.push_back(f.first);
+        s.fileImpact.push_back(f.second->hasInclude ? uint64_t(f.second->includeCount) * f.second->transitiveLoc : 0);
+    }
+    for (auto &f : sortedFiles) {
+        for (auto &d : f.second->dependencies) {
+            auto it = fileIndex.find(d);
+            if (it != fileIndex.end()) s.fileEdges.push_back(std::make_pair(fileIndex[f.second], it->second));
+        }
+    }
+    std::sort(s.fileEdges.begin(), s.fileEdges.end());
+    return s;
+}
+
+static void WriteEdges(std::ostream &out, const char *name, const std::vector<std::pair<size_t, size_t>> &edges) {
+    out << name << " " << edges.size() << "\n";
+    for (auto &e : edges) {
+        out << e.first << " " << e.second << "\n";
+    }
+}
+
+void WriteSnapshot(std::ostream &out, const Snapshot &snapshot) {
+    out << snapshotHeader << "\n";
+    out << "components " << snapshot.components.size() << "\n";
+    for (auto &c : snapshot.components) {
+        out << c << "\n";
+    }
+    out << "files " << snapshot.files.size() << "\n";
+    for (size_t n = 0; n < snapshot.files.size(); n++) {
+        out << snapshot.fileImpact[n] << " " << snapshot.files[n] << "\n";
+    }
+    WriteEdges(out, "dependencies", snapshot.componentEdges);
+    WriteEdges(out, "includes", snapshot.fileEdges);
+}
+
+static bool ReadCount(std::istream &in, const std::string &name, size_t &count) {
+    std::string line;
+    if (!std::getline(in, line) || line.compare(0, name.size() + 1, name + " ") != 0) return false;
+    count = strtoul(line.c_str() + name.size() + 1, NULL, 10);
+    return true;
+}
+
+static bool ReadEdges(std::istream &in, const char *name, size_t nodeCount, std::vector<std::pair<size_t, size_t>> &edges) {
+    size_t count;
+    if (!ReadCount(in, name, count)) return false;
+    edges.resize(count);
+    std::string line;
+    for (auto &e : edges) {
+        if (!std::getline(in, line)) return false;
+        std::istringstream parts(line);
+        if (!(parts >> e.first >> e.second) || e.first >= nodeCount || e.second >= nodeCount) return false;
+    }
+    return std::is_sorted(edges.begin(), edges.end());
+}
+
+bool ReadSnapshot(std::istream &in, Snapshot &snapshot) {
+    std::string line;
+    size_t count;
+    if (!std::getline(in, line) || line != snapshotHeader) return false;
+    if (!ReadCount(in, "components", count)) return false;
+    snapshot.components.resize(count);
+    for (auto &c : snapshot.components) {
+        if (!std::getline(in, c)) return false;
+    }
+    if (!ReadCount(in, "files", count)) return false;
+    snapshot.files.resize(count);
+    snapshot.fileImpact.resize(count);
+    for (size_t n = 0; n < count; n++) {
+        if (!std::getline(in, line)) return false;
+        size_t space = line.find(' ');
+        if (space == std::string::npos) return false;
+        snapshot.fileImpact[n] = strtoull(line.c_str(), NULL, 10);
+        snapshot.files[n] = line.substr(space + 1);
+    }
+    return ReadEdges(in, "dependencies", snapshot.components.size(), snapshot.componentEdges) &&
+           ReadEdges(in, "includes", snapshot.files.size(), snapshot.fileEdges);
+}
+
+// Merges two sorted name lists, telling for each name of either list its index in the merged list.
+// Because the mapping keeps the order, edges sorted by index stay sorted after renumbering.
+static std::vector<std::string> MergeNames(const std::vector<std::string> &a, const std::vector<std::string> &b,
+                                           std::vector<size_t> &mapA, std::vector<size_t> &mapB) {
+    std::vector<std::string> merged;
+    mapA.resize(a.size());
+    mapB.resize(b.size());
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i] < b[j])) {
+            mapA[i++] = merged.size();
+            merged.push_back(a[i - 1]);
+        } else if (i == a.size() || b[j] < a[i]) {
+            mapB[j++] = merged.size();
+            merged.push_back(b[j - 1]);
+        } else {
+            mapA[i++] = mapB[j++] = merged.size();
+            merged.push_back(a[i - 1]);
+        }
+    }
+    return merged;
+}
+
+static std::vector<std::pair<size_t, size_t>> Renumber(const std::vector<std::pair<size_t, size_t>> &edges, const std::vector<size_t> &map) {
+    std::vector<std::pair<size_t, size_t>> result;
+    result.reserve(edges.size());
+    for (auto &e : edges) {
+        result.push_back(std::make_pair(map[e.first], map[e.second]));
+    }
+    return result;
+}
+
+// The edges only in a and only in b, by a single pass over both sorted lists.
+static void DiffEdges(const std::vector<std::pair<size_t, size_t>> &a, const std::vector<std::pair<size_t, size_t>> &b,
+                      const std::vector<std::string> &names,
+                      std::vector<std::pair<std::string, std::string>> &onlyA,
+                      std::vector<std::pair<std::string, std::string>> &onlyB) {
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i] < b[j])) {
+            onlyA.push_back(std::make_pair(names[a[i].first], names[a[i].second]));
+            i++;
+        } else if (i == a.size() || b[j] < a[i]) {
+            onlyB.push_back(std::make_pair(names[b[j].first], names[b[j].second]));
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
+
+static void DiffCycles(const std::vector<std::string> &names, const std::vector<bool> &inBefore, const std::vector<bool> &inAfter,
+                       const std::vector<std::pair<size_t, size_t>> &edgesBefore,
+                       const std::vector<std::pair<size_t, size_t>> &edgesAfter, SnapshotDiff &diff) {
+    const size_t n = names.size(), none = static_cast<size_t>(-1);
+    Condensation before = Condense(MakeDigraph(n, edgesBefore));
+    Condensation after = Condense(MakeDigraph(n, edgesAfter));
+    auto cycleBefore = [&](size_t node) { return inBefore[node] && before.cyclic[before.componentOf[node]] ? before.componentOf[node] : none; };
+    auto cycleAfter = [&](size_t node) { return inAfter[node] && after.cyclic[after.componentOf[node]] ? after.componentOf[node] : none; };
+    for (size_t node = 0; node < n; node++) {
+        if (cycleAfter(node) != none && cycleBefore(node) == none) diff.newlyCyclic.push_back(names[node]);
+        if (cycleBefore(node) != none && cycleAfter(node) == none) diff.noLongerCyclic.push_back(names[node]);
+    }
+    // Compare every cycle now to the old cycle most of its members came from.
+    for (size_t scc = 0; scc < after.size(); scc++) {
+        if (!after.cyclic[scc]) continue;
+        std::unordered_map<size_t, size_t> origins;
+        size_t origin = none, originCount = 0;
+        for (size_t m = after.memberStart[scc]; m < after.memberStart[scc + 1]; m++) {
+            size_t old = cycleBefore(after.members[m]);
+            if (old == none) continue;
+            size_t count = ++origins[old];
+            if (count > originCount || (count == originCount && old < origin)) {
+                origin = old;
+                originCount = count;
+            }
+        }
+        CycleChange change;
+        for (size_t m = after.memberStart[scc]; m < after.memberStart[scc + 1]; m++) {
+            change.members.push_back(names[after.members[m]]);
+            if (cycleBefore(after.members[m]) != origin) change.joined.push_back(names[after.members[m]]);
+        }
+        if (origin != none) {
+            for (size_t m = before.memberStart[origin]; m < before.memberStart[origin + 1]; m++) {
+                if (cycleAfter(before.members[m]) != scc) change.left.push_back(names[before.members[m]]);
+            }
+        }
+        // A cycle made only of new members is already reported through newlyCyclic.
+        if (origin == none || (change.joined.empty() && change.left.empty())) continue;
+        std::sort(change.members.begin(), change.members.end());
+        std::sort(change.joined.begin(), change.joined.end());
+        std::sort(change.left.begin(), change.left.end());
+        diff.changedCycles.push_back(change);
+    }
+    std::sort(diff.changedCycles.begin(), diff.changedCycles.end(), [](const CycleChange &a, const CycleChange &b) {
+        return a.members < b.members;
+    });
+}
+
+SnapshotDiff DiffSnapshots(const Snapshot &before, const Snapshot &after) {
+    SnapshotDiff diff;
+    std::vector<size_t> mapBefore, mapAfter;
+    std::vector<std::string> components = MergeNames(before.components, after.components, mapBefore, mapAfter);
+    std::vector<bool> inBefore(components.size(), false), inAfter(components.size(), false);
+    for (auto &m : mapBefore) inBefore[m] = true;
+    for (auto &m : mapAfter) inAfter[m] = true;
+    for (size_t n = 0; n < components.size(); n++) {
+        if (inAfter[n] && !inBefore[n]) diff.addedComponents.push_back(components[n]);
+        if (inBefore[n] && !inAfter[n]) diff.removedComponents.push_back(components[n]);
+    }
+    std::vector<std::pair<size_t, size_t>> edgesBefore = Renumber(before.componentEdges, mapBefore);
+    std::vector<std::pair<size_t, size_t>> edgesAfter = Renumber(after.componentEdges, mapAfter);
+    DiffEdges(edgesBefore, edgesAfter, components, diff.removedDependencies, diff.addedDependencies);
+    DiffCycles(components, inBefore, inAfter, edgesBefore, edgesAfter, diff);
+
+    std::vector<std::string> files = MergeNames(before.files, after.files, mapBefore, mapAfter);
+    DiffEdges(Renumber(before.fileEdges, mapBefore), Renumber(after.fileEdges, mapAfter), files,
+              diff.removedIncludes, diff.addedIncludes);
+    std::vector<uint64_t> impactBefore(files.size(), 0), impactAfter(files.size(), 0);
+    diff.totalImpactBefore = diff.totalImpactAfter = 0;
+    for (size_t n = 0; n < before.files.size(); n++) {
+        impactBefore[mapBefore[n]] = before.fileImpact[n];
+        diff.totalImpactBefore += before.fileImpact[n];
+    }
+    for (size_t n = 0; n < after.files.size(); n++) {
+        impactAfter[mapAfter[n]] = after.fileImpact[n];
+        diff.totalImpactAfter += after.fileImpact[n];
+    }
+    for (size_t n = 0; n < files.size(); n++) {
+        if (impactBefore[n] != impactAfter[n]) {
+            diff.impactChanges.push_back(std::make_pair(files[n], std::make_pair(impactBefore[n], impactAfter[n])));
+        }
+    }
+    auto change = [](const std::pair<uint64_t, uint64_t> &i) { return i.first > i.second ? i.first - i.second : i.second - i.first; };
+    std::sort(diff.impactChanges.begin(), diff.impactChanges.end(), [&](const std::pair<std::string, std::pair<uint64_t, uint64_t>> &a,
+                                                                         const std::pair<std::string, std::pair<uint64_t, uint64_t>> &b) {
+        if (change(a.second) != change(b.second)) return change(a.second) > change(b.second);
+        return a.first < b.first;
+    });
+    return diff;
+}
+
+static bool ExceedsBudget(const Configuration& config, uint64_t before, uint64_t after, uint64_t slack) {
+    return after > before + slack && (after - before) * 100 > before * config.budgetImpactTolerance;
+}
+
+std::vector<BudgetViolation> CheckBudget(const Configuration& config, const Snapshot &baseline, const Snapshot &current) {
+    std::vector<BudgetViolation> violations;
+    SnapshotDiff diff = DiffSnapshots(baseline, current);
+    if (ExceedsBudget(config, diff.totalImpactBefore, diff.totalImpactAfter, 0)) {
+        violations.push_back(BudgetViolation{ BudgetViolation::TotalImpact, "", diff.totalImpactBefore, diff.totalImpactAfter });
+    }
+    for (auto &i : diff.impactChanges) {
+        if (ExceedsBudget(config, i.second.first, i.second.second, config.budgetImpactSlack)) {
+            violations.push_back(BudgetViolation{ BudgetViolation::Impact, i.first, i.second.first, i.second.second });
+        }
+    }
+
+    // Fan-out only changes through added and removed dependencies, so there is no need to count all of them again.
+    std::map<std::string, std::pair<uint64_t, int64_t>> fanOut;
+    for (auto &e : baseline.componentEdges) fanOut[baseline.components[e.first]].first++;
+    for (auto &d : diff.addedDependencies) fanOut[d.first].second++;
+    for (auto &d : diff.removedDependencies) fanOut[d.first].second--;
+    for (auto &f : fanOut) {
+        if (f.second.second > 0 && uint64_t(f.second.second) > config.budgetFanOutTolerance) {
+            violations.push_back(BudgetViolation{ BudgetViolation::FanOut, f.first, f.second.first, f.second.first + f.second.second });
+        }
+    }
+
+    // Components that were not in a cycle before, or that were in a different cycle that got merged into this one.
+    std::set<std::string> cyclic(diff.newlyCyclic.begin(), diff.newlyCyclic.end());
+    for (auto &c : diff.changedCycles) {
+        cyclic.insert(c.joined.begin(), c.joined.end());
+    }
+    for (auto &c : cyclic) {
+        violations.push_back(BudgetViolation{ BudgetViolation::Cycle, c, 0, 1 });
+    }
+    return violations;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2012-2016. TomTom International BV (http://tomtom.com).
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DEP_CHECKER__SNAPSHOT_H
+#define __DEP_CHECKER__SNAPSHOT_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct Component;
+struct Configuration;
+struct File;
+
+// The component and file graphs of one analysis, stored so that a later analysis can be compared to it.
+// Names are sorted and edges refer to them by index, sorted by (from, to).
+struct Snapshot {
+    std::vector<std::string> components;
+    std::vector<std::pair<size_t, size_t>> componentEdges;
+    std::vector<std::string> files;
+    std::vector<std::pair<size_t, size_t>> fileEdges;
+    // The includesize impact of every file: how often it is included times the lines it pulls in.
+    std::vector<uint64_t> fileImpact;
+};
+
+// Expects CalculateIncludeSizes to have been run on files.
+Snapshot MakeSnapshot(std::unordered_map<std::string, Component *> &components,
+                      std::unordered_map<std::string, File> &files);
+
+void WriteSnapshot(std::ostream &out, const Snapshot &snapshot);
+bool ReadSnapshot(std::istream &in, Snapshot &snapshot);
+
+// A set of names that belong together in a cycle, in a diff. Members not in the old cycle are marked as joined.
+struct CycleChange {
+    std::vector<std::string> members;
+    std::vector<std::string> joined;
+    std::vector<std::string> left;
+};
+
+struct SnapshotDiff {
+    std::vector<std::string> addedComponents, removedComponents;
+    std::vector<std::pair<std::string, std::string>> addedDependencies, removedDependencies;
+    std::vector<std::pair<std::string, std::string>> addedIncludes, removedIncludes;
+    // Components that are in a cycle now but were not before, and the other way around.
+    std::vector<std::string> newlyCyclic, noLongerCyclic;
+    // Cycles whose set of members changed.
+    std::vector<CycleChange> changedCycles;
+    // Files whose impact changed, with old and new impact, largest change first.
+    std::vector<std::pair<std::string, std::pair<uint64_t, uint64_t>>> impactChanges;
+    uint64_t totalImpactBefore, totalImpactAfter;
+};
+
+// Compares two snapshots in time linear in their size, apart from sorting the reported changes.
+SnapshotDiff DiffSnapshots(const Snapshot &before, const Snapshot &after);
+
+// A metric that grew beyond what the budget configuration allows since a baseline snapshot.
+struct BudgetViolation {
+    enum Kind { Impact, TotalImpact, FanOut, Cycle } kind;
+    std::string name;
+    uint64_t before, after;
+};
+
+// Checks per-file include impact, total impact, component fan-out and cycle membership against a
+// baseline, using the budget tolerances from the configuration.
+std::vector<BudgetViolation> CheckBudget(const Configuration& config, const Snapshot &baseline, const Snapshot &current);
+
+#endif
+
+
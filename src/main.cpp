@@ -19,12 +19,20 @@
 #include "Component.h"
 #include "Configuration.h"
 #include "Constants.h"
+#include "GitLog.h"
 #include <filesystem>
 #include <fstream>
 #include "Input.h"
+#include "MemoryStats.h"
 #include "Output.h"
+#include "Profile.h"
+#include "Snapshot.h"
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 static bool CheckVersionFile(const Configuration& config) {
     const std::string currentVersion = CURRENT_VERSION;
@@ -43,14 +51,26 @@ static std::string targetFrom(const std::string &arg) {
     return "./" + target;
 }
 
+static std::string fileFrom(const std::string &arg) {
+    std::string path = arg;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    while (path.compare(0, 2, "./") == 0) {
+        path.erase(0, 2);
+    }
+    return "./" + path;
+}
+
 class Operations {
 public:
     Operations(int argc, const char** argv)
     : loadStatus(Unloaded)
     , inferredComponents(false)
+    , lastCommandDidNothing(false)
+    , exitCode(0)
     , programName(argv[0])
     , allArgs(argv+1, argv+argc)
     , recursive(false)
+    , transitive(false)
     {
         if (std::filesystem::is_regular_file(CONFIG_FILE)) {
             std::ifstream in(CONFIG_FILE);
@@ -59,7 +79,8 @@ public:
         RegisterCommands();
         projectRoot = outputRoot = std::filesystem::current_path();
     }
-    void RunCommands() {
+    // Returns the exit code for the program, which is non-zero when a check failed.
+    int RunCommands() {
         if (allArgs.empty()) {
             allArgs.push_back("--help");
         }
@@ -79,16 +100,36 @@ public:
             std::cout << "You can also use this to run an analysis multiple times with a single change between them, or\n";
             std::cout << "to get various outputs from a single analysis run.\n";
         }
+        if (ProfilingEnabled()) {
+            PrintProfile(std::cout);
+            if (!traceFile.empty()) {
+                std::ofstream out(outputRoot / traceFile);
+                WriteChromeTrace(out);
+            }
+        }
+        if (MemoryStatsEnabled()) {
+            PrintMemoryStats(std::cout);
+        }
+        return exitCode;
     }
 private:
     typedef void (Operations::*Command)(std::vector<std::string>);
     void RegisterCommands() {
         commands["--ambiguous"] = &Operations::Ambiguous;
+        commands["--critical-path"] = &Operations::CriticalPath;
         commands["--cycles"] = &Operations::Cycles;
         commands["--dir"] = &Operations::Dir;
+        commands["--git-rev"] = &Operations::GitRev;
+        commands["--dominators"] = &Operations::Dominators;
+        commands["--centrality"] = &Operations::Centrality;
+        commands["--suggest-split"] = &Operations::SplitComponent;
+        commands["--suggest-merge"] = &Operations::MergeComponents;
         commands["--drop"] = &Operations::Drop;
         commands["--dryregen"] = &Operations::DryRegen;
         commands["--fixincludes"] = &Operations::FixIncludes;
+        commands["--dryfixincludes"] = &Operations::DryFixIncludes;
+        commands["--fixincludes-plan"] = &Operations::FixIncludesPlan;
+        commands["--dryfixincludes-plan"] = &Operations::DryFixIncludesPlan;
         commands["--graph-cycles"] = &Operations::GraphCycles;
         commands["--graph"] = &Operations::Graph;
         commands["--graph-target"] = &Operations::GraphTarget;
@@ -98,13 +139,24 @@ private:
         commands["--infer"] = &Operations::Infer;
         commands["--info"] = &Operations::Info;
         commands["--inout"] = &Operations::InOut;
+        commands["--levels"] = &Operations::Levels;
         commands["--outliers"] = &Operations::Outliers;
+        commands["--rebuild-cost"] = &Operations::RebuildCost;
         commands["--recursive"] = &Operations::Recursive;
+        commands["--redundant-includes"] = &Operations::RedundantIncludes;
         commands["--regen"] = &Operations::Regen;
         commands["--shortest"] = &Operations::Shortest;
         commands["--stats"] = &Operations::Stats;
+        commands["--transitive"] = &Operations::Transitive;
         commands["--usedby"] = &Operations::UsedBy;
+        commands["--history"] = &Operations::History;
+        commands["--snapshot"] = &Operations::WriteSnapshotFile;
+        commands["--diff"] = &Operations::DiffWithSnapshot;
+        commands["--check-budget"] = &Operations::CheckBudgetAgainst;
+        commands["--hotspots"] = &Operations::Hotspots;
         commands["--includeorigin"] = &Operations::IncludeOrigin;
+        commands["--profile"] = &Operations::Profile;
+        commands["--memstats"] = &Operations::MemStats;
     }
     void RunCommand(std::vector<std::string>::iterator &arg, std::vector<std::string>::iterator &end) {
         std::string lowerCommand;
@@ -113,16 +165,45 @@ private:
 
         Command c = commands[lowerCommand];
         if (!c) c = commands["--help"];
+        ProfileScope scope(lowerCommand);
         (this->*c)(std::vector<std::string>(arg, end));
     }
     void LoadProject(bool withLoc = false) {
         if (!withLoc && loadStatus >= FastLoad) return;
         if (withLoc && loadStatus >= FullLoad) return;
-        LoadFileList(config, components, files, projectRoot, inferredComponents, withLoc);
-        CreateIncludeLookupTable(files, includeLookup, collisions);
-        MapFilesToComponents(components, files);
-        ForgetEmptyComponents(components);
-        if (components.size() < 3) {
+        if (gitRevision.empty()) {
+            ProfileScope stage("LoadFileList");
+            LoadFileList(config, components, files, projectRoot, inferredComponents, withLoc);
+        } else {
+            ProfileScope stage("LoadFileListFromGit");
+            LoadFileListFromGit(config, components, files, projectRoot, gitRevision, inferredComponents, withLoc);
+        }
+        AnalyzeProject(false);
+        SetProfileValue("files", files.size());
+        SetProfileValue("components", components.size());
+        SetProfileValue("includeLookup entries", includeLookup.size());
+        SetProfileValue("colliding include paths", collisions.size());
+        SetProfileValue("distinct ambiguous includes", ambiguous.size());
+        loadStatus = (withLoc ? FullLoad : FastLoad);
+        lastCommandDidNothing = false;
+    }
+    // Returns the component named on the command line, or NULL. Unlike components[], this does not add an entry.
+    Component* FindComponent(const std::string& arg) {
+        auto it = components.find(targetFrom(arg));
+        return it == components.end() ? NULL : it->second;
+    }
+    // Resolves includes to dependencies between the components and files that were just loaded.
+    void AnalyzeProject(bool quiet) {
+        {
+            ProfileScope stage("CreateIncludeLookupTable");
+            CreateIncludeLookupTable(files, includeLookup, collisions);
+        }
+        {
+            ProfileScope stage("MapFilesToComponents");
+            MapFilesToComponents(components, files);
+            ForgetEmptyComponents(components);
+        }
+        if (!quiet && components.size() < 3) {
             std::cout << "Warning: Analyzing your project resulted in a very low amount of components. This either points to a small project, or\n";
             std::cout << "to cpp-dependencies not recognizing the components.\n\n";
 
@@ -134,22 +215,35 @@ private:
             std::cout << "Another reason for this warning may be running the tool in a folder that doesn't have any code. You can either change\n";
             std::cout << "to the desired directory, or use the --dir <myProject> option to make it analyze another directory.\n\n";
         }
-        MapIncludesToDependencies(includeLookup, ambiguous, components, files);
-        for (auto &i : ambiguous) {
-            for (auto &c : collisions[i.first]) {
-                files.find(c)->second.hasInclude = true; // There is at least one include that might end up here.
+        {
+            ProfileScope stage("MapIncludesToDependencies");
+            MapIncludesToDependencies(includeLookup, ambiguous, components, files);
+            for (auto &i : ambiguous) {
+                for (auto &c : collisions[i.first]) {
+                    files.find(c)->second.hasInclude = true; // There is at least one include that might end up here.
+                }
             }
         }
-        PropagateExternalIncludes(files);
-        ExtractPublicDependencies(components);
-        FindCircularDependencies(components);
+        {
+            ProfileScope stage("PropagateExternalIncludes");
+            PropagateExternalIncludes(files);
+        }
+        {
+            ProfileScope stage("ExtractPublicDependencies");
+            ExtractPublicDependencies(components);
+        }
+        {
+            ProfileScope stage("FindCircularDependencies");
+            FindCircularDependencies(components);
+        }
         for (auto& c : deleteComponents) {
             KillComponent(components, c);
         }
-        loadStatus = (withLoc ? FullLoad : FastLoad);
-        lastCommandDidNothing = false;
     }
     void UnloadProject() {
+        for (auto &c : components) {
+            delete c.second;
+        }
         components.clear();
         files.clear();
         collisions.clear();
@@ -166,12 +260,30 @@ private:
         }
         UnloadProject();
     }
+    void GitRev(std::vector<std::string> args) {
+        if (args.empty()) {
+            std::cout << "No revision specified after --git-rev\n";
+        } else {
+            gitRevision = args[0];
+        }
+        UnloadProject();
+    }
     void Ignore(std::vector<std::string> args) {
         if (args.empty())
             std::cout << "No files specified to ignore?\n";
         for (auto& s : args) config.blacklist.insert(s);
         UnloadProject();
     }
+    void Profile(std::vector<std::string> args) {
+        EnableProfiling();
+        if (!args.empty()) traceFile = args[0];
+    }
+    void MemStats(std::vector<std::string> ) {
+        EnableMemoryStats();
+        SetContainerSampler([this]() {
+            return EstimateContainers(files, components, includeLookup, collisions, ambiguous);
+        });
+    }
     void Infer(std::vector<std::string> ) {
         inferredComponents = true;
         UnloadProject();
@@ -247,7 +359,7 @@ private:
         } else if (!to) {
             std::cout << "No such component " << args[1] << "\n";
         } else {
-            FindSpecificLink(config, files, from, to);
+            FindSpecificLink(config, from, to);
         }
     }
     void Info(std::vector<std::string> args) {
@@ -263,13 +375,27 @@ private:
         if (args.empty())
             std::cout << "No files specified to find usage of...\n";
         for (auto& s : args) {
-            std::cout << "File " << s << " is used by:\n";
-            File* f = &files.find("./" + s)->second;
-            for (auto &p : files) {
-                if (p.second.dependencies.find(f) != p.second.dependencies.end()) {
-                    std::cout << "  " << p.second.path.string() << "\n";
+            auto it = files.find(fileFrom(s));
+            if (it == files.end()) {
+                std::cout << "No such file " << s << "\n";
+                continue;
+            }
+            File* f = &it->second;
+            std::vector<std::string> users;
+            if (transitive) {
+                for (auto& u : CollectTransitiveIncluders(std::vector<File*>(1, f))) {
+                    if (u != f) users.push_back(u->path.string());
+                }
+            } else {
+                for (auto& u : f->includedBy) {
+                    users.push_back(u->path.string());
                 }
             }
+            std::sort(users.begin(), users.end());
+            std::cout << "File " << s << " is used by:\n";
+            for (auto& u : users) {
+                std::cout << "  " << u << "\n";
+            }
         }
     }
     void IncludeOrigin(std::vector<std::string> args) {
@@ -313,14 +439,22 @@ private:
         }
     }
     void DoActualRegen(std::vector<std::string> args, bool dryRun) {
-        LoadProject();
+        // Choosing precompiled headers needs the lines of code of every file.
+        LoadProject(config.pchBudget > 0);
+        if (config.pchBudget > 0) {
+            CalculateIncludeSizes(files);
+        }
+        if (config.reduceLinkLibraries) {
+            FindImpliedLinkDependencies(components);
+        }
         std::filesystem::current_path(projectRoot);
+        std::vector<Component *> targets;
+        bool writeToStdoutInstead = false;
         if (args.empty()) {
             for (auto &c : components) {
-                RegenerateCmakeFilesForComponent(config, c.second, dryRun, false);
+                if (c.second) targets.push_back(c.second);
             }
         } else {
-            bool writeToStdoutInstead = false;
             if (args[0] == "-") {
                 dryRun = true; // Can't rewrite actual CMakeFiles if you asked them to be sent to stdout.
                 writeToStdoutInstead = true;
@@ -330,19 +464,51 @@ private:
                 const std::string target = targetFrom(s);
                 if (recursive) {
                     for (auto& c : components) {
-                        if (strstr(c.first.c_str(), target.c_str())) {
-                            RegenerateCmakeFilesForComponent(config, c.second, dryRun, writeToStdoutInstead);
+                        if (c.second && strstr(c.first.c_str(), target.c_str())) {
+                            targets.push_back(c.second);
                         }
                     }
                 } else {
-                    if (components.find(target) != components.end()) {
-                        RegenerateCmakeFilesForComponent(config, components[target], dryRun, writeToStdoutInstead);
+                    auto it = components.find(target);
+                    if (it != components.end() && it->second) {
+                        targets.push_back(it->second);
                     } else {
                         std::cout << "Target '" << target << "' not found\n";
                     }
                 }
             }
         }
+        if (writeToStdoutInstead) {
+            for (auto &c : targets) {
+                RegenerateCmakeFilesForComponent(config, c, dryRun, true);
+            }
+            return;
+        }
+        // Render and compare all components in parallel, but report the differences in a stable order.
+        std::sort(targets.begin(), targets.end(), [](const Component *a, const Component *b) { return a->root < b->root; });
+        // Components whose inputs did not change since the last run are skipped.
+        RegenRecords records;
+        {
+            std::ifstream in(REGEN_RECORD_FILE);
+            if (!in || !ReadRegenRecords(in, records)) records.clear();
+        }
+        std::vector<RegenRecord *> targetRecords;
+        for (auto &c : targets) {
+            targetRecords.push_back(&records.emplace(c->root.generic_string(), RegenRecord{ 0, 0, 0 }).first->second);
+        }
+        std::vector<char> changed(targets.size(), 0);
+        ParallelFor(targets.size(), [&](size_t n, size_t) {
+            changed[n] = RegenerateCmakeFilesForComponent(config, targets[n], dryRun, false, targetRecords[n]);
+        });
+        if (!dryRun) {
+            std::ofstream out(REGEN_RECORD_FILE);
+            WriteRegenRecords(out, records);
+        }
+        if (dryRun) {
+            for (size_t n = 0; n < targets.size(); n++) {
+                if (changed[n]) std::cout << "Difference detected at " << targets[n]->root << "\n";
+            }
+        }
     }
     void Regen(std::vector<std::string> args) {
         bool versionIsCorrect = CheckVersionFile(config);
@@ -355,7 +521,30 @@ private:
     void DryRegen(std::vector<std::string> args) {
         DoActualRegen(args, true);
     }
-    void FixIncludes(std::vector<std::string> args) {
+    // Adds a relocation for a "<component> <desired path> [<relative root>]" triple, unless the component
+    // is unknown or already has one.
+    bool AddIncludeRelocation(std::vector<IncludeRelocation>& plan, const std::vector<std::string>& args) {
+        Component* c = FindComponent(args[0]);
+        if (!c) {
+            std::cout << "No such component " << args[0] << "\n";
+            return false;
+        }
+        for (auto& relocation : plan) {
+            if (relocation.component == c) {
+                std::cout << "Component " << args[0] << " is relocated more than once\n";
+                return false;
+            }
+        }
+        plan.push_back(IncludeRelocation{ c, args[1], args.size() == 3 && args[2] == "project" });
+        return true;
+    }
+    void DoActualFixIncludes(const std::vector<IncludeRelocation>& plan, bool dryRun) {
+        // File paths are relative to the project root.
+        std::filesystem::current_path(projectRoot);
+        UpdateIncludes(files, includeLookup, plan, dryRun);
+        std::filesystem::current_path(outputRoot);
+    }
+    void DoActualFixIncludes(std::vector<std::string> args, bool dryRun) {
         if (args.size() < 2 || args.size() > 3) {
             std::cout << "Invalid input to fixincludes command\n";
             std::cout << "Required: --fixincludes <component> <desired path> [<relative root>]\n";
@@ -364,14 +553,59 @@ private:
         }
 
         LoadProject();
-        bool absolute = args.size() == 3 && args[2] == "project";
-        Component* c = components[targetFrom(args[0])];
-        if (!c) {
-            std::cout << "No such component " << args[0] << "\n";
-        } else {
-            UpdateIncludes(files, includeLookup, c, args[1], absolute);
+        std::vector<IncludeRelocation> plan;
+        if (AddIncludeRelocation(plan, args)) {
+            DoActualFixIncludes(plan, dryRun);
         }
     }
+    void FixIncludes(std::vector<std::string> args) {
+        DoActualFixIncludes(args, false);
+    }
+    void DryFixIncludes(std::vector<std::string> args) {
+        DoActualFixIncludes(args, true);
+    }
+    void DoActualFixIncludesPlan(std::vector<std::string> args, bool dryRun) {
+        if (args.size() != 1) {
+            std::cout << "Required: --fixincludes-plan <plan file>\n";
+            return;
+        }
+        std::ifstream in(args[0]);
+        if (!in) {
+            std::cout << "Cannot read " << args[0] << "\n";
+            return;
+        }
+
+        LoadProject();
+        std::vector<IncludeRelocation> plan;
+        std::string line;
+        size_t lineNumber = 0;
+        bool valid = true;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            std::istringstream words(line);
+            std::vector<std::string> triple;
+            std::string word;
+            while (words >> word && word[0] != '#') triple.push_back(word);
+            if (triple.empty()) continue;
+            if (triple.size() > 3 || triple.size() < 2) {
+                std::cout << args[0] << ":" << lineNumber << ": expected <component> <desired path> [<relative root>]\n";
+                valid = false;
+            } else if (!AddIncludeRelocation(plan, triple)) {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            std::cout << "Not changing any files\n";
+            return;
+        }
+        DoActualFixIncludes(plan, dryRun);
+    }
+    void FixIncludesPlan(std::vector<std::string> args) {
+        DoActualFixIncludesPlan(args, false);
+    }
+    void DryFixIncludesPlan(std::vector<std::string> args) {
+        DoActualFixIncludesPlan(args, true);
+    }
     void Outliers(std::vector<std::string>) {
         LoadProject(true);
         PrintAllComponents(components, "Libraries with no links in:", [this](const Component& c){
@@ -389,26 +623,7 @@ private:
     }
     void IncludeSize(std::vector<std::string>) {
         LoadProject(true);
-        std::unordered_map<File*, size_t> includeCount;
-        for (auto& f : files) {
-            if (f.second.hasInclude) continue;
-            std::set<File*> filesIncluded;
-            std::vector<File*> todo;
-            todo.push_back(&f.second);
-            while (!todo.empty()) {
-                File* file_todo = todo.back();
-                todo.pop_back();
-                for (auto& d : file_todo->dependencies) {
-                    if (filesIncluded.insert(d).second) todo.push_back(d);
-                }
-            }
-
-            size_t total = 0;
-            for (auto& i : filesIncluded) { 
-                total += i->loc;
-                i->includeCount++;
-            }
-        }
+        CalculateIncludeSizes(files);
         struct entry {
             std::string path;
             size_t includecount, loc;
@@ -421,31 +636,373 @@ private:
                 impact = includecount * loc;
             }
             bool operator<(const entry& other) const {
-                return impact > other.impact;
+                return impact > other.impact || (impact == other.impact && path < other.path);
             }
         };
         std::vector<entry> entries;
         for (auto& f : files) {
             if (!f.second.hasInclude) continue;
-            std::set<File*> filesIncluded;
-            std::vector<File*> todo;
-            todo.push_back(&f.second);
+            if (f.second.includeCount > 0 && f.second.transitiveLoc > 0) {
+                entries.push_back(entry(f.second.path.string(), f.second.includeCount, f.second.transitiveLoc));
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        for (auto& entry : entries) {
+            std::cout << "impact=" << entry.impact << " LOC=" << entry.loc << " count=" << entry.includecount << " name=" << entry.path << "\n";
+        }
+    }
+    void RebuildCost(std::vector<std::string> args) {
+        LoadProject(true);
+        if (!args.empty() && args[0] == "-") {
+            // Read the changed files from stdin, for example from "git diff --name-only".
+            args.erase(args.begin());
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                size_t first = line.find_first_not_of(" \t\r"), last = line.find_last_not_of(" \t\r");
+                if (first != std::string::npos) {
+                    args.push_back(line.substr(first, last - first + 1));
+                }
+            }
+        }
+        if (args.empty()) {
+            std::cout << "No changed files specified to calculate the rebuild cost of\n";
+            return;
+        }
+        std::vector<File*> changed;
+        for (auto& s : args) {
+            auto it = files.find(fileFrom(s));
+            if (it == files.end()) {
+                std::cout << "Ignoring " << s << ", not a known source file\n";
+            } else {
+                changed.push_back(&it->second);
+            }
+        }
+        std::map<std::string, std::pair<size_t, size_t>> perComponent;
+        size_t totalUnits = 0, totalLoc = 0;
+        for (auto& f : CollectTransitiveIncluders(changed)) {
+            if (!IsCompileableFile(f->path.extension().string())) continue;
+            totalUnits++;
+            totalLoc += f->loc;
+            if (f->component) {
+                std::pair<size_t, size_t>& entry = perComponent[f->component->NiceName('.')];
+                entry.first++;
+                entry.second += f->loc;
+            }
+        }
+        std::cout << "Rebuilding " << totalUnits << " compile units with " << totalLoc << " lines of code in "
+                  << perComponent.size() << " components\n";
+        std::vector<std::pair<std::string, std::pair<size_t, size_t>>> sorted(perComponent.begin(), perComponent.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, std::pair<size_t, size_t>>& a,
+                                                          const std::pair<std::string, std::pair<size_t, size_t>>& b) {
+            return a.second.second > b.second.second;
+        });
+        for (auto& c : sorted) {
+            std::cout << "  " << c.first << ": " << c.second.first << " compile units, " << c.second.second << " LOC\n";
+        }
+    }
+    void Levels(std::vector<std::string> args) {
+        LoadProject(true);
+        bool byUnits = !args.empty() && args[0] == "units";
+        PrintBuildLevels(CalculateBuildLevels(components, byUnits), byUnits ? "compile units" : "LOC");
+    }
+    void CriticalPath(std::vector<std::string> args) {
+        LoadProject(true);
+        bool byUnits = !args.empty() && args[0] == "units";
+        PrintCriticalPath(CalculateBuildLevels(components, byUnits), byUnits ? "compile units" : "LOC");
+    }
+    void RedundantIncludes(std::vector<std::string> args) {
+        LoadProject();
+        std::set<Component*> selected;
+        for (auto& s : args) {
+            Component* c = FindComponent(s);
+            if (!c) {
+                std::cout << "No such component " << s << "\n";
+                return;
+            }
+            selected.insert(c);
+        }
+        std::map<std::string, std::vector<std::string>> perComponent;
+        size_t count = 0;
+        for (auto& r : FindRedundantIncludes(files)) {
+            if (!r.file->component || (!selected.empty() && !selected.count(r.file->component))) continue;
+            for (auto& include : r.file->rawIncludes) {
+                if (ResolveInclude(files, includeLookup, *r.file, include.first, include.second) != r.target) continue;
+                perComponent[r.file->component->NiceName('.')].push_back(
+                    r.file->path.string() + ": #include " + (include.second ? "<" : "\"") + include.first + (include.second ? ">" : "\"") +
+                    " (already included through " + r.via->path.string() + ")");
+                count++;
+            }
+        }
+        std::cout << "Found " << count << " redundant includes in " << perComponent.size() << " components\n";
+        for (auto& c : perComponent) {
+            std::cout << "\n" << c.first << ":\n";
+            for (auto& line : c.second) {
+                std::cout << "  " << line << "\n";
+            }
+        }
+    }
+    void Dominators(std::vector<std::string> args) {
+        LoadProject(true);
+        std::vector<File*> roots;
+        for (auto& s : args) {
+            auto it = files.find(fileFrom(s));
+            Component* c = (it == files.end() ? FindComponent(s) : NULL);
+            if (it != files.end()) {
+                roots.push_back(&it->second);
+            } else if (c) {
+                for (auto& f : c->files) {
+                    if (IsCompileableFile(f->path.extension().string())) roots.push_back(f);
+                }
+            } else {
+                std::cout << "No such file or component " << s << "\n";
+            }
+        }
+        if (args.empty()) {
+            for (auto& f : files) {
+                if (IsCompileableFile(f.second.path.extension().string())) roots.push_back(&f.second);
+            }
+        }
+        for (auto& g : FindGatewayHeaders(files, roots)) {
+            std::cout << "dominated=" << g.dominatedLoc << " files=" << g.dominatedFiles << " roots=" << g.roots
+                      << " name=" << g.file->path.string() << "\n";
+        }
+    }
+    void Centrality(std::vector<std::string> args) {
+        LoadProject(true);
+        bool onFiles = false;
+        size_t samples = 0;
+        for (auto& a : args) {
+            if (a == "files") {
+                onFiles = true;
+            } else {
+                samples = strtoul(a.c_str(), NULL, 10);
+            }
+        }
+        std::vector<std::string> names;
+        Digraph graph;
+        if (onFiles) {
+            FileGraph fg = BuildFileGraph(files);
+            for (auto& f : fg.files) names.push_back(f->path.string());
+            graph = std::move(fg.graph);
+        } else {
+            ComponentGraph cg = BuildComponentGraph(components);
+            for (auto& c : cg.components) names.push_back(c->NiceName('.'));
+            graph = std::move(cg.graph);
+        }
+        std::vector<double> betweenness = BetweennessCentrality(graph, samples);
+        std::vector<double> rank = PageRank(graph, 0.85);
+        std::vector<size_t> order(names.size());
+        for (size_t n = 0; n < order.size(); n++) order[n] = n;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (betweenness[a] != betweenness[b]) return betweenness[a] > betweenness[b];
+            if (rank[a] != rank[b]) return rank[a] > rank[b];
+            return names[a] < names[b];
+        });
+        // Formatted separately, so that the fixed notation does not stick to std::cout for later commands.
+        std::ostringstream out;
+        out << std::fixed;
+        for (auto& n : order) {
+            out << "betweenness=" << std::setprecision(1) << betweenness[n] << " pagerank=" << std::setprecision(6) << rank[n]
+                << " name=" << names[n] << "\n";
+        }
+        std::cout << out.str();
+    }
+    void SplitComponent(std::vector<std::string> args) {
+        LoadProject(true);
+        if (args.empty()) {
+            std::cout << "No component given to split\n";
+            return;
+        }
+        Component* c = FindComponent(args[0]);
+        if (!c) {
+            std::cout << "No such component " << args[0] << "\n";
+            return;
+        }
+        size_t parts = (c->loc() + config.componentLocUpperLimit - 1) / std::max<size_t>(config.componentLocUpperLimit, 1);
+        if (args.size() > 1) parts = strtoul(args[1].c_str(), NULL, 10);
+        parts = std::max<size_t>(parts, 2);
+        PrintSplitSuggestion(*c, SuggestSplit(*c, parts));
+    }
+    void MergeComponents(std::vector<std::string> args) {
+        LoadProject(true);
+        std::vector<Component*> candidates;
+        for (auto& s : args) {
+            Component* c = FindComponent(s);
+            if (c) {
+                candidates.push_back(c);
+            } else {
+                std::cout << "No such component " << s << "\n";
+            }
+        }
+        if (args.empty()) {
+            for (auto& c : components) {
+                if (c.second && !c.second->files.empty() && c.second->loc() < config.componentLocLowerLimit) candidates.push_back(c.second);
+            }
+        }
+        PrintMergeSuggestions(SuggestMerges(candidates));
+    }
+    void Hotspots(std::vector<std::string> args) {
+        LoadProject(true);
+        size_t days = args.empty() ? 30 : strtoul(args[0].c_str(), NULL, 10);
+        if (days == 0) days = 30;
+        const int64_t since = int64_t(time(NULL)) - int64_t(days) * 24 * 3600;
+        CommitLog log = ReadGitHistory(projectRoot, since, projectRoot / ".cpp-dependencies-gitlog");
+        std::unordered_map<File*, size_t> changes;
+        for (auto& commit : log.commits) {
+            for (auto& path : commit.files) {
+                auto it = files.find(fileFrom(path));
+                if (it != files.end()) changes[&it->second]++;
+            }
+        }
+        std::cout << "Changes in the last " << days << " days: " << log.commits.size() << " commits, " << changes.size() << " known files\n";
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        for (auto& h : FindHotspots(files, changes, days / 30.0)) {
+            out << "rebuilds/month=" << h.rebuildsPerMonth << " changes=" << h.changes << " units=" << h.compileUnits
+                << " loc=" << h.compileLoc << " name=" << h.file->path.string() << "\n";
+        }
+        std::cout << out.str();
+    }
+    void History(std::vector<std::string> args) {
+        if (args.empty()) {
+            std::cout << "No revision range specified after --history\n";
+            return;
+        }
+        GitRepository repository(projectRoot);
+        if (!repository.IsValid()) {
+            std::cout << "No git repository found for " << projectRoot.string() << ", or built without zlib\n";
+            return;
+        }
+        // <from>..<to> walks back from <to> until <from>; a single revision walks back to the first commit.
+        std::string range = args[0], fromRev, toRev = range;
+        size_t dots = range.find("..");
+        if (dots != std::string::npos) {
+            fromRev = range.substr(0, dots);
+            toRev = range.substr(dots + 2);
+            if (toRev.empty()) toRev = "HEAD";
+        }
+        ObjectId from, to, tree;
+        std::vector<ObjectId> parents;
+        if ((!fromRev.empty() && !repository.ResolveCommit(fromRev, from)) || !repository.ResolveCommit(toRev, to)) {
+            std::cout << "Cannot resolve revision range " << range << "\n";
+            return;
+        }
+        // Everything reachable from <from> is left out, as git does for a range. Commit times cannot tell,
+        // since they need not increase along history.
+        std::unordered_set<ObjectId, ObjectIdHash> excluded;
+        if (!fromRev.empty()) {
+            std::vector<ObjectId> todo(1, from);
+            excluded.insert(from);
             while (!todo.empty()) {
-                File* todo_file = todo.back();
+                ObjectId commit = todo.back();
                 todo.pop_back();
-                for (auto& d : todo_file->dependencies) {
-                    if (filesIncluded.insert(d).second) todo.push_back(d);
+                if (!repository.ReadCommit(commit, tree, parents)) continue;
+                for (auto& parent : parents) {
+                    if (excluded.insert(parent).second) todo.push_back(parent);
                 }
             }
-            size_t total = 0;
-            for (auto& i : filesIncluded) total += i->loc;
-            if (f.second.includeCount > 0 && total > 0) {
-                entries.push_back(entry(f.second.path.string(), f.second.includeCount, total));
+        }
+        // Follow first parents, the main line of history, stopping at <from> or one of its ancestors.
+        struct HistoryEntry { ObjectId commit, tree; int64_t time; };
+        std::vector<HistoryEntry> history;
+        ObjectId current = to;
+        for (;;) {
+            HistoryEntry entry = { current, ObjectId(), 0 };
+            if (excluded.count(current) || !repository.ReadCommit(current, entry.tree, parents, &entry.time)) {
+                break;
             }
+            history.push_back(entry);
+            if (parents.empty()) break;
+            current = parents[0];
         }
-        std::sort(entries.begin(), entries.end());
-        for (auto& entry : entries) {
-            std::cout << "impact=" << entry.impact << " LOC=" << entry.loc << " count=" << entry.includecount << " name=" << entry.path << "\n";
+        std::error_code ec;
+        std::filesystem::path subdir = std::filesystem::absolute(projectRoot, ec).lexically_normal().lexically_relative(repository.WorkTree());
+
+        std::cout << "commit,time,files,loc,components,public_dependencies,private_dependencies,components_in_cycles,"
+                     "compile_units,include_loc\n";
+        BlobScanCache scanCache;
+        ObjectId lastTree;
+        std::string lastMetrics;
+        for (size_t n = history.size(); n-- > 0;) {
+            ObjectId analyzed;
+            if (!repository.FindTree(history[n].tree, subdir, analyzed)) continue;
+            // Commits that did not touch the analyzed directory have the same numbers as the one before.
+            if (lastMetrics.empty() || analyzed != lastTree) {
+                UnloadProject();
+                LoadFileListFromGit(config, components, files, repository, analyzed, inferredComponents, true, &scanCache);
+                AnalyzeProject(true);
+                CalculateIncludeSizes(files);
+                size_t loc = 0, compileUnits = 0, includeLoc = 0, publicDeps = 0, privateDeps = 0;
+                for (auto &f : files) {
+                    loc += f.second.loc;
+                    if (IsCompileableFile(f.second.path.extension().string())) {
+                        compileUnits++;
+                        includeLoc += f.second.transitiveLoc;
+                    }
+                }
+                for (auto &c : components) {
+                    publicDeps += c.second->pubDeps.size();
+                    privateDeps += c.second->privDeps.size();
+                }
+                lastMetrics = std::to_string(files.size()) + "," + std::to_string(loc) + "," + std::to_string(components.size()) + "," +
+                              std::to_string(publicDeps) + "," + std::to_string(privateDeps) + "," + std::to_string(NodesWithCycles(components)) + "," +
+                              std::to_string(compileUnits) + "," + std::to_string(includeLoc);
+                lastTree = analyzed;
+            }
+            std::cout << ToHex(history[n].commit) << "," << history[n].time << "," << lastMetrics << std::endl;
+        }
+        UnloadProject();
+        lastCommandDidNothing = false;
+    }
+    void WriteSnapshotFile(std::vector<std::string> args) {
+        if (args.empty()) {
+            std::cout << "No output file specified after --snapshot\n";
+            return;
+        }
+        LoadProject(true);
+        CalculateIncludeSizes(files);
+        std::ofstream out(args[0]);
+        WriteSnapshot(out, MakeSnapshot(components, files));
+        if (!out) std::cout << "Cannot write snapshot to " << args[0] << "\n";
+    }
+    void DiffWithSnapshot(std::vector<std::string> args) {
+        if (args.empty()) {
+            std::cout << "No baseline snapshot specified after --diff\n";
+            return;
+        }
+        Snapshot baseline;
+        std::ifstream in(args[0]);
+        if (!ReadSnapshot(in, baseline)) {
+            std::cout << "Cannot read snapshot from " << args[0] << "\n";
+            return;
+        }
+        LoadProject(true);
+        CalculateIncludeSizes(files);
+        size_t maxImpactChanges = args.size() > 1 ? strtoul(args[1].c_str(), NULL, 10) : 20;
+        PrintSnapshotDiff(DiffSnapshots(baseline, MakeSnapshot(components, files)), maxImpactChanges);
+    }
+    void CheckBudgetAgainst(std::vector<std::string> args) {
+        if (args.empty()) {
+            std::cout << "No baseline snapshot specified after --check-budget\n";
+            exitCode = 1;
+            return;
+        }
+        Snapshot baseline;
+        std::ifstream in(args[0]);
+        if (!ReadSnapshot(in, baseline)) {
+            std::cout << "Cannot read snapshot from " << args[0] << "\n";
+            exitCode = 1;
+            return;
+        }
+        LoadProject(true);
+        CalculateIncludeSizes(files);
+        std::vector<BudgetViolation> violations = CheckBudget(config, baseline, MakeSnapshot(components, files));
+        PrintBudgetViolations(violations);
+        if (violations.empty()) {
+            std::cout << "Within the budget of " << args[0] << "\n";
+        } else {
+            std::cout << violations.size() << " budget violations against " << args[0] << "\n";
+            exitCode = 1;
         }
     }
     void Ambiguous(std::vector<std::string>) {
@@ -467,6 +1024,9 @@ private:
         recursive = true;
         UnloadProject();
     }
+    void Transitive(std::vector<std::string>) {
+        transitive = true;
+    }
     void Help(std::vector<std::string>) {
         std::cout << "C++ Dependencies -- a tool to analyze large C++ code bases for #include dependency information\n";
         std::cout << "Copyright (C) 2016, TomTom International BV\n";
@@ -498,13 +1058,42 @@ private:
         std::cout << "                                            - files that are more than 2000 LoC\n";
         std::cout << "                                            - files that are not compiled and never included\n";
         std::cout << "    --includesize                    : Calculate the total number of lines added to each file through #include\n";
+        std::cout << "    --levels [units]                 : Group components into levels that can be built in parallel, weighted by\n";
+        std::cout << "                                       lines of code or, with \"units\", by compile units\n";
+        std::cout << "    --critical-path [units]          : Show the heaviest chain of components that must be built one after another,\n";
+        std::cout << "                                       and the components whose splitting would shorten it the most\n";
+        std::cout << "    --dominators [<file or target>...] : Find the headers that are the only way to include a part of the include\n";
+        std::cout << "                                       graph of the given (or all) compile units, with the lines of code behind them\n";
+        std::cout << "    --centrality [files] [samples]   : Rank components (or files) by how many dependency paths pass through them,\n";
+        std::cout << "                                       with their PageRank. A sample count estimates from that many sources.\n";
+        std::cout << "    --suggest-split <target> [parts] : Split a component into parts of about equal size with the fewest includes\n";
+        std::cout << "                                       between them. Defaults to enough parts to get below componentLocUpperLimit.\n";
+        std::cout << "    --suggest-merge [<target>...]    : Suggest the component each of the given (or too small) components is most\n";
+        std::cout << "                                       tightly coupled to\n";
+        std::cout << "    --history <from>..<to>           : Print dependency statistics as CSV for every commit on the main line of git\n";
+        std::cout << "                                       history between the two revisions, oldest first.\n";
+        std::cout << "    --snapshot <file>                : Save the component and file graphs with the include impact of every file.\n";
+        std::cout << "    --diff <snapshot> [count]        : Compare the current analysis to a saved snapshot: added and removed\n";
+        std::cout << "                                       dependencies, changed cycles and the (default 20) largest changes in\n";
+        std::cout << "                                       include impact. Combine with --git-rev to compare revisions.\n";
+        std::cout << "    --check-budget <snapshot>        : Fail with a non-zero exit code when include impact, component fan-out or\n";
+        std::cout << "                                       cycles grew beyond the configured budget since the snapshot.\n";
+        std::cout << "    --hotspots [days]                : Rank files by how often they changed in git in the last days (default 30)\n";
+        std::cout << "                                       times the compile units including them. Caches the history it reads\n";
+        std::cout << "                                       in .cpp-dependencies-gitlog.\n";
+        std::cout << "    --rebuild-cost <file...>         : Compile units and lines of code to rebuild when the given files change.\n";
+        std::cout << "                                       Use \"-\" to read the file names from stdin, for example from\n";
+        std::cout << "                                       \"git diff --name-only\".\n";
         std::cout << "\n";
         std::cout << "  Target information:\n";
         std::cout << "    --info                           : Show all information on a given specific target\n";
         std::cout << "    --usedby                         : Find all references to a specific header file\n";
+        std::cout << "                                       After --transitive, also the files that include it indirectly\n";
         std::cout << "    --includeorigin                  : Find a path from a given source file to a given header file. Both should be full paths\n";
         std::cout << "    --inout                          : Find all incoming and outgoing links for a target\n";
         std::cout << "    --ambiguous                      : Find all include statements that could refer to more than one header\n";
+        std::cout << "    --redundant-includes [<target>...] : Find include statements for headers that are already included\n";
+        std::cout << "                                       through another include of the same file\n";
         std::cout << "\n";
         std::cout << "  Refactoring:\n";
         std::cout << "    --fixincludes <targetname> <desired path> [<relative root>]\n";
@@ -512,10 +1101,19 @@ private:
         std::cout << "                                       <relative root> can be:\n";
         std::cout << "                                            - \"project\" for absolute paths (default);\n";
         std::cout << "                                            - \"component\" for component-relative paths.\n";
+        std::cout << "                                       Only files whose text changes are written.\n";
+        std::cout << "    --dryfixincludes <targetname> <desired path> [<relative root>]\n";
+        std::cout << "                                     : Show the changes --fixincludes would make as a unified diff.\n";
+        std::cout << "    --fixincludes-plan <file>        : Like --fixincludes for every \"<targetname> <desired path> [<relative root>]\"\n";
+        std::cout << "                                       line in <file>, changing every file at most once. Includes whose new\n";
+        std::cout << "                                       path would find another header, or be ambiguous, are left as they are.\n";
+        std::cout << "    --dryfixincludes-plan <file>     : Show the changes --fixincludes-plan would make as a unified diff.\n";
         std::cout << "\n";
         std::cout << "  Automatic CMakeLists.txt generation:\n";
         std::cout << "     Note: These commands only have any effect on CMakeLists.txt marked with \"" << config.regenTag << "\"\n";
         std::cout << "    --regen                          : Re-generate all marked CMakeLists.txt with the component information derived.\n";
+        std::cout << "                                       Components whose inputs did not change since the last run, as recorded\n";
+        std::cout << "                                       in " REGEN_RECORD_FILE ", are skipped.\n";
         std::cout << "    --dryregen                       : Verify which CMakeLists would be regenerated if you were to run --regen now.\n";
         std::cout << "\n";
         std::cout << "  What-if analysis:\n";
@@ -528,8 +1126,15 @@ private:
         std::cout << "                                       because of this component\n";
         std::cout << "    --infer                          : Pretend that every folder that holds a source file is also a component.\n";
         std::cout << "    --dir <sourcedirectory>          : Source directory to run in. Assumed current one if unspecified.\n";
+        std::cout << "    --git-rev <revision>             : Analyze the source directory as it is in the given git revision, read from\n";
+        std::cout << "                                       the repository without a checkout. Use \"\" for the working tree again.\n";
         std::cout << "    --recursive                      : If for the following command a single target/directory is specified\n";
         std::cout << "                                       recursively process the underlying targets/directories too.\n";
+        std::cout << "    --transitive                     : Make the following --usedby commands also report indirect includes.\n";
+        std::cout << "    --profile [<trace.json>]         : Time the loading stages and the following commands, count what was read and\n";
+        std::cout << "                                       print a summary at the end. Optionally also write a Chrome trace file.\n";
+        std::cout << "    --memstats                       : Report the heap use, resident memory and the size of the main containers\n";
+        std::cout << "                                       after every loading stage and following command.\n";
     }
     Configuration config;
     enum LoadStatus {
@@ -539,6 +1144,7 @@ private:
     } loadStatus;
     bool inferredComponents;
     bool lastCommandDidNothing;
+    int exitCode;
     std::string programName;
     std::map<std::string, Command> commands;
     std::vector<std::string> allArgs;
@@ -548,12 +1154,13 @@ private:
     std::unordered_map<std::string, std::string> includeLookup;
     std::map<std::string, std::vector<std::string>> ambiguous;
     std::set<std::string> deleteComponents;
-    std::filesystem::path outputRoot, projectRoot;
+    std::string gitRevision;
+    std::filesystem::path outputRoot, projectRoot, traceFile;
     bool recursive;
+    bool transitive;
 };
 
 int main(int argc, const char **argv) {
     Operations op(argc, argv);
-    op.RunCommands();
-    return 0;
+    return op.RunCommands();
 }
@@ -0,0 +1,56 @@
+#include "test.h"
+#include "Analysis.h"
+
+static Component* AddComponent(std::unordered_map<std::string, Component *>& components, std::vector<File*>& files, const char* name, size_t loc) {
+  Component* c = components[name] = new Component(std::string("./") + name);
+  File* f = new File(std::string("./") + name + "/" + name + ".cpp");
+  f->loc = loc;
+  f->component = c;
+  c->files.insert(f);
+  files.push_back(f);
+  return c;
+}
+
+TEST(CalculateBuildLevelsLevelsADiamond) {
+  std::unordered_map<std::string, Component *> components;
+  std::vector<File*> files;
+  Component* top = AddComponent(components, files, "top", 10);
+  Component* left = AddComponent(components, files, "left", 100);
+  Component* right = AddComponent(components, files, "right", 20);
+  Component* bottom = AddComponent(components, files, "bottom", 5);
+  top->privDeps.insert(left);
+  top->pubDeps.insert(right);
+  left->privDeps.insert(bottom);
+  right->privDeps.insert(bottom);
+
+  BuildLevels levels = CalculateBuildLevels(components, false);
+
+  ASSERT(levels.groups.size() == 4);
+  ASSERT(levels.levelCount == 3);
+  ASSERT(levels.criticalWeight == 115);
+  ASSERT(levels.criticalPath.size() == 3);
+  ASSERT(levels.groups[levels.criticalPath[0]][0] == top);
+  ASSERT(levels.groups[levels.criticalPath[1]][0] == left);
+  ASSERT(levels.groups[levels.criticalPath[2]][0] == bottom);
+  // Without left the heaviest chain is top, right, bottom with 35 LOC.
+  ASSERT(levels.splitGains[0].second == 80);
+  ASSERT(levels.groups[levels.splitGains[0].first][0] == left);
+}
+
+TEST(CalculateBuildLevelsGroupsCycles) {
+  std::unordered_map<std::string, Component *> components;
+  std::vector<File*> files;
+  Component* a = AddComponent(components, files, "a", 1);
+  Component* b = AddComponent(components, files, "b", 2);
+  Component* c = AddComponent(components, files, "c", 4);
+  a->privDeps.insert(b);
+  b->privDeps.insert(a);
+  b->privDeps.insert(c);
+
+  BuildLevels levels = CalculateBuildLevels(components, true);
+
+  ASSERT(levels.groups.size() == 2);
+  ASSERT(levels.levelCount == 2);
+  ASSERT(levels.criticalWeight == 3);
+  ASSERT(levels.groups[levels.criticalPath[0]].size() == 2);
+}
@@ -0,0 +1,58 @@
+#include "test.h"
+#include "Analysis.h"
+#include "TestUtils.h"
+
+TEST(FindGatewayHeadersFindsTheOnlyWayIn) {
+  // main.cpp -> a.h -> b.h -> d.h, a.h -> c.h -> d.h, main.cpp -> e.h -> c.h
+  std::unordered_map<std::string, File> files;
+  File* main = AddFile(files, "./main.cpp");
+  main->loc = 1;
+  File* a = AddFile(files, "./a.h");
+  a->loc = 10;
+  File* b = AddFile(files, "./b.h");
+  b->loc = 20;
+  File* c = AddFile(files, "./c.h");
+  c->loc = 40;
+  File* d = AddFile(files, "./d.h");
+  d->loc = 80;
+  File* e = AddFile(files, "./e.h");
+  e->loc = 160;
+  main->dependencies = { a, e };
+  a->dependencies = { b, c };
+  b->dependencies = { d };
+  c->dependencies = { d };
+  e->dependencies = { c };
+
+  std::vector<GatewayHeader> gateways = FindGatewayHeaders(files, std::vector<File*>(1, main));
+
+  // Only a.h dominates another file: b.h. Both c.h and d.h can be reached in two ways.
+  ASSERT(gateways.size() == 1);
+  ASSERT(gateways[0].file == a);
+  ASSERT(gateways[0].dominatedLoc == 30);
+  ASSERT(gateways[0].dominatedFiles == 2);
+  ASSERT(gateways[0].roots == 1);
+}
+
+TEST(FindGatewayHeadersSumsOverRoots) {
+  std::unordered_map<std::string, File> files;
+  File* x = AddFile(files, "./x.cpp");
+  x->loc = 1;
+  File* y = AddFile(files, "./y.cpp");
+  y->loc = 1;
+  File* a = AddFile(files, "./a.h");
+  a->loc = 5;
+  File* b = AddFile(files, "./b.h");
+  b->loc = 7;
+  x->dependencies = { a };
+  y->dependencies = { a };
+  a->dependencies = { b };
+  b->dependencies = { a };
+
+  std::vector<File*> roots = { x, y };
+  std::vector<GatewayHeader> gateways = FindGatewayHeaders(files, roots);
+
+  ASSERT(gateways.size() == 1);
+  ASSERT(gateways[0].file == a);
+  ASSERT(gateways[0].dominatedLoc == 24);
+  ASSERT(gateways[0].roots == 2);
+}
@@ -0,0 +1,30 @@
+#include "test.h"
+#include "Analysis.h"
+#include "TestUtils.h"
+
+TEST(FindHotspotsWeighsChangesByIncludingCompileUnits) {
+  std::unordered_map<std::string, File> files;
+  File* a = AddFile(files, "./a.cpp");
+  a->loc = 100;
+  File* b = AddFile(files, "./b.cpp");
+  b->loc = 200;
+  File* common = AddFile(files, "./common.h");
+  common->loc = 10;
+  File* local = AddFile(files, "./local.h");
+  local->loc = 10;
+  a->dependencies = { common, local };
+  b->dependencies = { common };
+  std::unordered_map<File*, size_t> changes = { { common, 3 }, { local, 4 }, { a, 1 } };
+
+  std::vector<Hotspot> hotspots = FindHotspots(files, changes, 2.0);
+
+  ASSERT(hotspots.size() == 3);
+  ASSERT(hotspots[0].file == common);
+  ASSERT(hotspots[0].compileUnits == 2);
+  ASSERT(hotspots[0].compileLoc == 300);
+  ASSERT(hotspots[0].rebuildsPerMonth == 3.0);
+  ASSERT(hotspots[1].file == local);
+  ASSERT(hotspots[1].rebuildsPerMonth == 2.0);
+  ASSERT(hotspots[2].file == a);
+  ASSERT(hotspots[2].compileUnits == 1);
+}
@@ -0,0 +1,70 @@
+#include "test.h"
+#include "Analysis.h"
+
+namespace {
+// The components and their files live in the maps of the test, so that nothing has to be freed.
+struct Project {
+  std::unordered_map<std::string, Component> storage;
+  std::unordered_map<std::string, File> files;
+  std::unordered_map<std::string, Component *> components;
+};
+}
+
+static Component* AddComponent(Project& project, const char* name) {
+  Component* c = &project.storage.emplace(name, Component(std::string("./") + name)).first->second;
+  std::string path = std::string("./") + name + "/" + name + ".cpp";
+  File* f = &project.files.emplace(path, File(path)).first->second;
+  f->component = c;
+  c->files.insert(f);
+  project.components[name] = c;
+  return c;
+}
+
+TEST(FindImpliedLinkDependenciesFollowsPublicLinks) {
+  Project project;
+  Component* app = AddComponent(project, "app");
+  Component* lib = AddComponent(project, "lib");
+  Component* base = AddComponent(project, "base");
+  Component* util = AddComponent(project, "util");
+  Component* extra = AddComponent(project, "extra");
+  app->pubDeps = { lib, base };
+  app->privDeps = { util, extra };
+  lib->pubDeps = { base };
+  lib->privDeps = { util };
+  util->pubDeps = { extra };
+
+  FindImpliedLinkDependencies(project.components);
+
+  // base comes along publicly with lib; lib only links util privately; extra comes along with util.
+  ASSERT((app->impliedDeps == std::unordered_set<Component*>{ base, extra }));
+  ASSERT(lib->impliedDeps.empty());
+
+  // A public dependency is not implied by a private one.
+  app->pubDeps = { lib, extra };
+  app->privDeps = { util };
+  FindImpliedLinkDependencies(project.components);
+  ASSERT(app->impliedDeps.empty());
+}
+
+TEST(FindImpliedLinkDependenciesSkipsCycles) {
+  Project project;
+  Component* a = AddComponent(project, "a");
+  Component* b = AddComponent(project, "b");
+  Component* c = AddComponent(project, "c");
+  Component* x = AddComponent(project, "x");
+  Component* y = AddComponent(project, "y");
+  Component* z = AddComponent(project, "z");
+  a->pubDeps = { b };
+  b->pubDeps = { a };
+  c->pubDeps = { a, b };
+  x->pubDeps = { y, z };
+  y->pubDeps = { x, z };
+
+  FindImpliedLinkDependencies(project.components);
+
+  // a and b bring each other along, but one of them has to stay.
+  ASSERT(c->impliedDeps.empty());
+  // z reached through y only counts if y does not depend on x itself.
+  ASSERT(x->impliedDeps.empty());
+  ASSERT(y->impliedDeps.empty());
+}
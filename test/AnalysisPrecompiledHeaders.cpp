@@ -0,0 +1,69 @@
+#include "test.h"
+#include "Analysis.h"
+#include "TestUtils.h"
+
+TEST(SelectPrecompiledHeadersPicksSharedHeadersWithinBudget) {
+  std::unordered_map<std::string, File> files;
+  Component comp("./comp"), base("./base");
+  File* a = AddFile(files, "./comp/a.cpp");
+  a->component = &comp;
+  comp.files.insert(a);
+  File* b = AddFile(files, "./comp/b.cpp");
+  b->component = &comp;
+  comp.files.insert(b);
+  File* c = AddFile(files, "./comp/c.cpp");
+  c->component = &comp;
+  comp.files.insert(c);
+  File* common = AddFile(files, "./comp/common.h");
+  common->component = &comp;
+  comp.files.insert(common);
+  common->transitiveLoc = 500;
+  File* rare = AddFile(files, "./comp/rare.h");
+  rare->component = &comp;
+  comp.files.insert(rare);
+  rare->transitiveLoc = 5000;
+  File* baseHeader = AddFile(files, "./base/base.h");
+  baseHeader->component = &base;
+  base.files.insert(baseHeader);
+  baseHeader->transitiveLoc = 400;
+  a->dependencies = { common, rare };
+  b->dependencies = { common };
+  c->dependencies = { baseHeader };
+  c->AddIncludeStmt(true, "base/base.h");
+  c->AddIncludeStmt(true, "map");
+  common->dependencies = { baseHeader };
+  baseHeader->includedBy = { c, common };
+  common->AddIncludeStmt(true, "vector");
+
+  ASSERT(SelectPrecompiledHeaders(comp, 0, 1000).empty());
+  // <vector> has the highest score, then base.h; common.h no longer fits.
+  std::vector<std::string> small = SelectPrecompiledHeaders(comp, 1500, 1000);
+  ASSERT((small == std::vector<std::string>{ "<vector>", "<base/base.h>" }));
+  // common.h pulls in both earlier picks, so it replaces them.
+  std::vector<std::string> large = SelectPrecompiledHeaders(comp, 2000, 1000);
+  ASSERT((large == std::vector<std::string>{ "common.h" }));
+}
+
+TEST(SelectPrecompiledHeadersCountsTheHeadersOwnLines) {
+  std::unordered_map<std::string, File> files;
+  Component comp("./comp");
+  File* a = AddFile(files, "./comp/a.cpp");
+  a->component = &comp;
+  comp.files.insert(a);
+  File* b = AddFile(files, "./comp/b.cpp");
+  b->component = &comp;
+  comp.files.insert(b);
+  File* leaf = AddFile(files, "./comp/leaf.h");
+  leaf->component = &comp;
+  comp.files.insert(leaf);
+  File* small = AddFile(files, "./comp/small.h");
+  small->component = &comp;
+  comp.files.insert(small);
+  leaf->loc = 800;
+  small->loc = 100;
+  a->dependencies = { leaf, small };
+  b->dependencies = { leaf, small };
+
+  ASSERT((SelectPrecompiledHeaders(comp, 850, 1000) == std::vector<std::string>{ "leaf.h" }));
+  ASSERT((SelectPrecompiledHeaders(comp, 900, 1000) == std::vector<std::string>{ "leaf.h", "small.h" }));
+}
@@ -0,0 +1,31 @@
+#include "test.h"
+#include "Analysis.h"
+#include "TestUtils.h"
+
+TEST(FindRedundantIncludesFindsIncludeReachedThroughAnother) {
+  std::unordered_map<std::string, File> files;
+  File* a = AddFile(files, "./a.cpp");
+  File* b = AddFile(files, "./b.h");
+  File* c = AddFile(files, "./c.h");
+  File* d = AddFile(files, "./d.h");
+  a->dependencies = { b, c, d };
+  b->dependencies = { d };
+  d->dependencies = { c };
+
+  std::vector<RedundantInclude> found = FindRedundantIncludes(files);
+
+  ASSERT(found.size() == 2);
+  ASSERT(found[0].file == a && found[0].target == c);
+  ASSERT(found[1].file == a && found[1].target == d && found[1].via == b);
+}
+
+TEST(FindRedundantIncludesIgnoresIncludesWithinACycle) {
+  std::unordered_map<std::string, File> files;
+  File* a = AddFile(files, "./a.h");
+  File* b = AddFile(files, "./b.h");
+  File* c = AddFile(files, "./c.h");
+  a->dependencies = { b, c };
+  b->dependencies = { a, c };
+
+  ASSERT(FindRedundantIncludes(files).empty());
+}
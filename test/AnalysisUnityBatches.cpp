@@ -0,0 +1,64 @@
+#include "test.h"
+#include "Analysis.h"
+#include "TestUtils.h"
+
+TEST(GroupUnityBatchesGroupsUnitsBySharedIncludes) {
+  std::unordered_map<std::string, File> files;
+  Component comp("./comp");
+  File* a = AddFile(files, "./comp/a.h");
+  a->component = &comp;
+  comp.files.insert(a);
+  File* b = AddFile(files, "./comp/b.h");
+  b->component = &comp;
+  comp.files.insert(b);
+  std::vector<File*> units;
+  for (int n = 0; n < 8; n++) {
+    File* unit = AddFile(files, "./comp/x" + std::to_string(n) + ".cpp");
+    unit->component = &comp;
+    comp.files.insert(unit);
+    unit->dependencies = { n % 2 ? b : a };
+    units.push_back(unit);
+  }
+
+  std::vector<std::vector<File*>> batches = GroupUnityBatches(comp, 4);
+  ASSERT(batches.size() == 2);
+  ASSERT((batches[0] == std::vector<File*>{ units[0], units[2], units[4], units[6] }));
+  ASSERT((batches[1] == std::vector<File*>{ units[1], units[3], units[5], units[7] }));
+  ASSERT(GroupUnityBatches(comp, 0).empty());
+  ASSERT(GroupUnityBatches(comp, 3).size() == 3);
+}
+
+TEST(GroupUnityBatchesKeepsClustersTogetherInLargeComponent) {
+  std::unordered_map<std::string, File> files;
+  Component comp("./comp");
+  File* common = AddFile(files, "./comp/common.h");
+  common->component = &comp;
+  comp.files.insert(common);
+  const int clusters = 30, perCluster = 100;
+  std::vector<File*> headers;
+  for (int c = 0; c < clusters; c++) {
+    File* header = AddFile(files, "./comp/h" + std::to_string(c) + ".h");
+    header->component = &comp;
+    comp.files.insert(header);
+    header->dependencies = { common };
+    headers.push_back(header);
+  }
+  std::unordered_map<File*, int> clusterOf;
+  for (int n = 0; n < clusters * perCluster; n++) {
+    // Spread every cluster over the whole path order.
+    File* f = AddFile(files, "./comp/u" + std::to_string(n) + ".cpp");
+    f->component = &comp;
+    comp.files.insert(f);
+    f->dependencies = { headers[n % clusters] };
+    clusterOf[f] = n % clusters;
+  }
+
+  std::vector<std::vector<File*>> batches = GroupUnityBatches(comp, 10);
+  ASSERT(batches.size() == clusters * perCluster / 10);
+  for (auto& batch : batches) {
+    ASSERT(batch.size() == 10);
+    for (auto& f : batch) {
+      ASSERT(clusterOf[f] == clusterOf[batch.front()]);
+    }
+  }
+}
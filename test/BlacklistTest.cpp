@@ -0,0 +1,34 @@
+#include "test.h"
+#include "Blacklist.h"
+
+TEST(BlacklistMatchesPathPrefixesAndFileNames) {
+  BlacklistMatcher matcher({ "build", "Visual Studio Projects", "lib/gen", "stdint.h" });
+  ASSERT(matcher.Matches("./build"));
+  ASSERT(matcher.Matches("./build/x.cpp"));
+  ASSERT(matcher.Matches("./buildtools"));
+  ASSERT(matcher.Matches("./Visual Studio Projects"));
+  ASSERT(matcher.Matches("./lib/generated.h"));
+  ASSERT(matcher.Matches("./src/stdint.h"));
+  ASSERT(matcher.Matches("stdint.h"));
+  ASSERT(matcher.Matches("./src/build"));
+  ASSERT(!matcher.Matches("./src/builds"));
+  ASSERT(!matcher.Matches("./lib/other/gen"));
+  ASSERT(!matcher.Matches("./src/mystdint.h"));
+  ASSERT(!matcher.Matches("./bui"));
+}
+
+TEST(BlacklistMatchesGlobs) {
+  BlacklistMatcher matcher({ "**/third_party/*", "test/*_generated.?pp", "out/**" });
+  ASSERT(matcher.Matches("./third_party/zlib"));
+  ASSERT(matcher.Matches("./a/b/third_party/zlib"));
+  ASSERT(!matcher.Matches("./a/third_party"));
+  ASSERT(!matcher.Matches("./a/my_third_party/zlib"));
+  ASSERT(!matcher.Matches("./a/third_party/zlib/zlib.h"));
+  ASSERT(matcher.Matches("./test/a_generated.cpp"));
+  ASSERT(matcher.Matches("./test/a_generated.hpp"));
+  ASSERT(!matcher.Matches("./test/sub/a_generated.cpp"));
+  ASSERT(!matcher.Matches("./test/a_generated.cxx"));
+  ASSERT(matcher.Matches("./out/"));
+  ASSERT(matcher.Matches("./out/x/y.h"));
+  ASSERT(!matcher.Matches("./output"));
+}
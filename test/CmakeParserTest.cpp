@@ -0,0 +1,48 @@
+#include "test.h"
+#include "CmakeParser.h"
+#include <string>
+
+TEST(ParseCmakeSplitsCommandsAndArguments) {
+  const std::string text =
+    "# leading comment\n"
+    "project(demo CXX)\n"
+    "add_library(${PROJECT_NAME} STATIC\n"
+    "  a.cpp # trailing comment\n"
+    "  \"with space.h\" [==[bracket ) text]==]\n"
+    "  $<$<CONFIG:Debug>:debug.cpp>\n"
+    ")\n"
+    "#[[ bracket\n comment ]]\n"
+    "if((A AND B) OR C) endif()\n";
+  CmakeFile file = ParseCmake(text.data(), text.size());
+  ASSERT(file.commands.size() == 4);
+  ASSERT(file.comments.size() == 3);
+  ASSERT(file.comments[0] == " leading comment");
+  ASSERT(file.comments[2] == " bracket\n comment ");
+
+  const CmakeCommand& project = file.commands[0];
+  ASSERT(project.name == "project");
+  ASSERT(project.args.size() == 2 && project.args[0].value == "demo");
+
+  const CmakeCommand& library = file.commands[1];
+  ASSERT(library.name == "add_library");
+  ASSERT(library.line == 2);
+  ASSERT(library.args.size() == 6);
+  ASSERT(library.args[2].value == "a.cpp" && library.args[2].line == 3);
+  ASSERT(library.args[3].spelling == "\"with space.h\"");
+  ASSERT(library.args[3].value == "with space.h");
+  ASSERT(library.args[4].value == "bracket ) text");
+  ASSERT(library.args[5].value == "$<$<CONFIG:Debug>:debug.cpp>");
+  ASSERT(text.substr(library.begin, library.end - library.begin).back() == ')');
+
+  ASSERT(file.commands[2].name == "if");
+  ASSERT(file.commands[2].args.size() == 5);
+  ASSERT(file.commands[3].name == "endif");
+}
+
+TEST(ParseCmakeStopsAtUnclosedCommand) {
+  const std::string text = "set(A \"unterminated\n";
+  CmakeFile file = ParseCmake(text.data(), text.size());
+  ASSERT(file.commands.size() == 1);
+  ASSERT(file.commands[0].args.size() == 2);
+  ASSERT(file.commands[0].end == text.size());
+}
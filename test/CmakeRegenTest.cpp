@@ -225,6 +225,46 @@ TEST(RegenerateCmakeTargetLinkLibraries_PublicPrivate) {
   ASSERT(oss.str() == expectedOutput);
 }
 
+TEST(RegenerateCmakeTargetPrecompileHeaders) {
+  const std::vector<std::string> headers{
+    "<vector>",
+    "common.h"
+  };
+
+  const std::string expectedOutput(
+      "target_precompile_headers(${PROJECT_NAME}\n"
+      "  PRIVATE\n"
+      "    <vector>\n"
+      "    common.h\n"
+      ")\n"
+      "\n");
+
+  std::ostringstream oss;
+  RegenerateCmakeTargetPrecompileHeaders(oss, headers);
+  ASSERT(oss.str() == expectedOutput);
+
+  std::ostringstream empty;
+  RegenerateCmakeTargetPrecompileHeaders(empty, {});
+  ASSERT(empty.str().empty());
+}
+
+TEST(RegenerateCmakeUnityBuild) {
+  const std::vector<std::vector<std::string>> batches{
+    { "a.cpp", "b.cpp" },
+    { "sub/c.cpp" }
+  };
+
+  const std::string expectedOutput(
+      "set_target_properties(${PROJECT_NAME} PROPERTIES UNITY_BUILD ON UNITY_BUILD_MODE GROUP)\n"
+      "set_source_files_properties(a.cpp b.cpp PROPERTIES UNITY_GROUP unity_0)\n"
+      "set_source_files_properties(sub/c.cpp PROPERTIES UNITY_GROUP unity_1)\n"
+      "\n");
+
+  std::ostringstream oss;
+  RegenerateCmakeUnityBuild(oss, batches);
+  ASSERT(oss.str() == expectedOutput);
+}
+
 TEST(RegenerateCmakeTargetLinkLibraries_Public) {
   bool isHeaderOnly = false;
   const std::set<std::string> publicDeps{
@@ -448,3 +488,53 @@ TEST(RegenerateCmakeAddSubdirectory_SubDirsWithAndWithoutCmakeLists) {
 
   ASSERT(oss.str() == expectedOutput);
 }
+
+TEST(RegenRecordsRoundTrip) {
+  RegenRecords records;
+  records["./a"] = RegenRecord{ 0x123456789abcdefULL, 42, 1234567890123LL };
+  records["./b c"] = RegenRecord{ 1, 0, 0 };
+  std::stringstream ss;
+  WriteRegenRecords(ss, records);
+
+  RegenRecords read;
+  ASSERT(ReadRegenRecords(ss, read));
+  ASSERT(read.size() == 2);
+  ASSERT(read["./a"].fingerprint == 0x123456789abcdefULL);
+  ASSERT(read["./a"].size == 42);
+  ASSERT(read["./a"].modified == 1234567890123LL);
+  ASSERT(read["./b c"].fingerprint == 1);
+
+  std::istringstream wrongHeader("something else\n");
+  ASSERT(!ReadRegenRecords(wrongHeader, read));
+}
+
+TEST(RegenerateCmakeFilesForComponent_SkipsUnchangedInputs) {
+  TemporaryWorkingDirectory workdir(name);
+  std::filesystem::create_directories(workdir() / "MyComponent");
+  std::ofstream((workdir() / "MyComponent" / "CMakeLists.txt").c_str()).close();
+  Configuration config;
+  Component comp("./MyComponent");
+  comp.recreate = true;
+  File file("./MyComponent/a.cpp");
+  comp.files.insert(&file);
+  const std::filesystem::path cmakeLists = "MyComponent/CMakeLists.txt";
+
+  RegenRecord record = { 0, 0, 0 };
+  ASSERT(RegenerateCmakeFilesForComponent(config, &comp, false, false, &record));
+  ASSERT(record.fingerprint == CmakeListsFingerprint(config, &comp));
+  ASSERT(record.size == std::filesystem::file_size(cmakeLists));
+
+  // Same inputs and an untouched file: nothing is rendered or compared.
+  ASSERT(!RegenerateCmakeFilesForComponent(config, &comp, true, false, &record));
+
+  Component dep("./Dependency");
+  comp.privDeps.insert(&dep);
+  ASSERT(CmakeListsFingerprint(config, &comp) != record.fingerprint);
+  ASSERT(RegenerateCmakeFilesForComponent(config, &comp, true, false, &record));
+  comp.privDeps.clear();
+
+  // A file changed by hand is regenerated even though its inputs are the same.
+  std::ofstream(cmakeLists.c_str(), std::ios::app) << "# edited\n";
+  ASSERT(RegenerateCmakeFilesForComponent(config, &comp, false, false, &record));
+  ASSERT(!RegenerateCmakeFilesForComponent(config, &comp, false, false, &record));
+}
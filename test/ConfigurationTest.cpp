@@ -16,6 +16,14 @@ TEST(DefaultConfiguration)
   ASSERT(config.componentLocLowerLimit == 200);
   ASSERT(config.componentLocUpperLimit == 20000);
   ASSERT(config.fileLocUpperLimit == 2000);
+  ASSERT(config.budgetImpactTolerance == 5);
+  ASSERT(config.budgetImpactSlack == 10000);
+  ASSERT(config.budgetFanOutTolerance == 0);
+  ASSERT(config.pchBudget == 0);
+  ASSERT(config.pchExternalHeaderLoc == 5000);
+  ASSERT(config.unityBuildBatchSize == 0);
+  ASSERT(!config.includeCountLabels);
+  ASSERT(!config.reduceLinkLibraries);
   ASSERT(config.addLibraryAliases.size() == 1);
   ASSERT(config.addLibraryAliases.count("add_library") == 1);
   ASSERT(config.addExecutableAliases.size() == 1);
@@ -36,7 +44,15 @@ TEST(ReadConfigurationFile)
      << "componentLocLowerLimit: 1\n"
      << "componentLocUpperLimit: 123\n"
      << "fileLocUpperLimit: 567          # could have a comment here\n"
+     << "budgetImpactTolerance: 10\n"
+     << "budgetImpactSlack: 0\n"
+     << "budgetFanOutTolerance: 3\n"
+     << "pchBudget: 40000\n"
+     << "pchExternalHeaderLoc: 800\n"
+     << "unityBuildBatchSize: 12\n"
      << "reuseCustomSections: true\n"
+     << "reduceLinkLibraries: true\n"
+     << "includeCountLabels: true\n"
      << "blacklist: [\n"
      << "  a.h\n"
      << "  b.h\n"
@@ -55,6 +71,12 @@ TEST(ReadConfigurationFile)
   ASSERT(config.componentLocLowerLimit == 1);
   ASSERT(config.componentLocUpperLimit == 123);
   ASSERT(config.fileLocUpperLimit == 567);
+  ASSERT(config.budgetImpactTolerance == 10);
+  ASSERT(config.budgetImpactSlack == 0);
+  ASSERT(config.budgetFanOutTolerance == 3);
+  ASSERT(config.pchBudget == 40000);
+  ASSERT(config.pchExternalHeaderLoc == 800);
+  ASSERT(config.unityBuildBatchSize == 12);
   ASSERT(config.addLibraryAliases.size() == 1);
   ASSERT(config.addLibraryAliases.count("add_library") == 1);
   ASSERT(config.addExecutableAliases.size() == 1);
@@ -64,6 +86,8 @@ TEST(ReadConfigurationFile)
   ASSERT(config.blacklist.count("b.h") == 1);
   ASSERT(config.blacklist.count("stdint.h") == 0);
   ASSERT(config.reuseCustomSections);
+  ASSERT(config.reduceLinkLibraries);
+  ASSERT(config.includeCountLabels);
 }
 
 TEST(ReadConfigurationFile_Aliases)
@@ -0,0 +1,78 @@
+#include "test.h"
+#include "GitLog.h"
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+
+TEST(ParseGitLogReadsCommitsAndFiles) {
+  std::istringstream in("commit abc 1700000000\n\nsrc/a.h\nsrc/b.cpp\n\ncommit def 1600000000\n\ncommit 123 1500000000\n\nc.h\n");
+  std::vector<CommitFiles> commits = ParseGitLog(in);
+
+  ASSERT(commits.size() == 3);
+  ASSERT(commits[0].id == "abc");
+  ASSERT(commits[0].time == 1700000000);
+  ASSERT(commits[0].files.size() == 2);
+  ASSERT(commits[0].files[1] == "src/b.cpp");
+  ASSERT(commits[1].files.empty());
+  ASSERT(commits[2].files.size() == 1);
+}
+
+TEST(CommitLogRoundTrips) {
+  CommitLog log = { 1234, { { "abc", 2000, { "a.h", "b.h" } }, { "def", 1500, {} } } };
+  std::stringstream buffer;
+  WriteCommitLog(buffer, log);
+  CommitLog read;
+
+  ASSERT(ReadCommitLog(buffer, read));
+  ASSERT(read.since == 1234);
+  ASSERT(read.commits.size() == 2);
+  ASSERT(read.commits[0].files == log.commits[0].files);
+  ASSERT(read.commits[1].id == "def");
+}
+
+TEST(ReadGitHistoryOnlyReadsNewCommits) {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "cpp-dependencies-gitlog-test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "src");
+  std::string git = "git -C \"" + dir.string() + "\" -c user.name=test -c user.email=test@example.com ";
+  std::ofstream(dir / "src" / "a.h") << "int a;\n";
+  if (system((git + "init -q && " + git + "add -A && " + git + "commit -qm first").c_str()) != 0) {
+    // No git available; nothing to test.
+    return;
+  }
+  std::filesystem::path cache = dir / "cache";
+  CommitLog first = ReadGitHistory(dir / "src", 0, cache);
+  ASSERT(first.commits.size() == 1);
+  ASSERT(first.commits[0].files == std::vector<std::string>(1, "a.h"));
+
+  // Mark the cached commit, so that it shows whether the next read used the cache.
+  first.commits[0].files.push_back("cached.h");
+  {
+    std::ofstream out(cache);
+    WriteCommitLog(out, first);
+  }
+  std::ofstream(dir / "src" / "b.h") << "int b;\n";
+  ASSERT(system((git + "add -A && " + git + "commit -qm second").c_str()) == 0);
+  CommitLog second = ReadGitHistory(dir / "src", 0, cache);
+
+  ASSERT(second.commits.size() == 2);
+  ASSERT(second.commits[0].files == std::vector<std::string>(1, "b.h"));
+  ASSERT(second.commits[1].files.size() == 2);
+
+  // A commit from before a later, shorter window is dropped from the cache.
+  second.commits.push_back(CommitFiles{ "0000000000000000000000000000000000000000", 1, { "old.h" } });
+  {
+    std::ofstream out(cache);
+    WriteCommitLog(out, second);
+  }
+  CommitLog third = ReadGitHistory(dir / "src", 10, cache);
+  ASSERT(third.commits.size() == 2);
+  CommitLog cached;
+  {
+    std::ifstream in(cache);
+    ASSERT(ReadCommitLog(in, cached));
+  }
+  ASSERT(cached.since == 10);
+  ASSERT(cached.commits.size() == 2);
+  std::filesystem::remove_all(dir);
+}
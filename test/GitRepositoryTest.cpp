@@ -0,0 +1,108 @@
+#include "test.h"
+#include "Component.h"
+#include "Configuration.h"
+#include "GitRepository.h"
+#include "Input.h"
+#include <fstream>
+#include <stdlib.h>
+
+static void WriteFile(const std::filesystem::path& path, const std::string& content) {
+  std::ofstream(path) << content;
+}
+
+TEST(GitRepositoryReadsLooseAndPackedObjects) {
+#ifdef WITH_ZLIB
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "cpp-dependencies-gitrepository-test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "sub");
+  std::string git = "git -C \"" + dir.string() + "\" -c user.name=test -c user.email=test@example.com ";
+  std::string text;
+  for (int n = 0; n < 200; n++) text += "int line" + std::to_string(n) + ";\n";
+  WriteFile(dir / "sub" / "a.h", text);
+  if (system((git + "init -q && " + git + "add -A && " + git + "commit -qm first && " + git + "tag v1").c_str()) != 0) {
+    // No git available; nothing to test.
+    return;
+  }
+  WriteFile(dir / "sub" / "a.h", text + "int more;\n");
+  ASSERT(system((git + "commit -qam second").c_str()) == 0);
+
+  // Everything is loose now; after gc the first version becomes a delta or a delta base.
+  for (int pass = 0; pass < 2; pass++) {
+    GitRepository repository(dir / "sub");
+    ASSERT(repository.IsValid());
+    ObjectId commit, root, tree;
+    std::vector<ObjectId> parents;
+    ASSERT(repository.ResolveCommit("HEAD~1", commit));
+    ObjectId tagged;
+    ASSERT(repository.ResolveCommit("v1", tagged));
+    ASSERT(tagged == commit);
+    ASSERT(repository.ResolveCommit(ToHex(commit).substr(0, 8), tagged));
+    ASSERT(tagged == commit);
+    ASSERT(repository.ReadCommit(commit, root, parents));
+    ASSERT(parents.empty());
+    ASSERT(repository.FindTree(root, "sub", tree));
+    std::vector<TreeEntry> entries;
+    ASSERT(repository.ReadTree(tree, entries));
+    ASSERT(entries.size() == 1);
+    ASSERT(entries[0].name == "a.h");
+    ObjectType type;
+    std::string content;
+    ASSERT(repository.ReadObject(entries[0].id, type, content));
+    ASSERT(type == ObjectType::Blob);
+    ASSERT(content == text);
+
+    ASSERT(repository.ResolveCommit("HEAD", commit));
+    ASSERT(repository.ReadCommit(commit, root, parents));
+    ASSERT(parents.size() == 1);
+    ASSERT(repository.FindTree(root, "sub", tree));
+    ASSERT(repository.ReadTree(tree, entries));
+    ASSERT(repository.ReadObject(entries[0].id, type, content));
+    ASSERT(content == text + "int more;\n");
+    ASSERT(!repository.ResolveCommit("nonexistent", commit));
+
+    ASSERT(system((git + "gc -q").c_str()) == 0);
+  }
+  std::filesystem::remove_all(dir);
+#endif
+}
+
+TEST(LoadFileListFromGitReusesScannedBlobs) {
+#ifdef WITH_ZLIB
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "cpp-dependencies-blobcache-test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir / "lib");
+  std::string git = "git -C \"" + dir.string() + "\" -c user.name=test -c user.email=test@example.com ";
+  WriteFile(dir / "lib" / "CMakeLists.txt", "project(lib)\nadd_library(lib STATIC\n  a.cpp\n)\n");
+  WriteFile(dir / "lib" / "a.cpp", "#include \"a.h\"\nint a;\n");
+  WriteFile(dir / "lib" / "a.h", "int b;\n");
+  if (system((git + "init -q && " + git + "add -A && " + git + "commit -qm first").c_str()) != 0) {
+    return;
+  }
+  GitRepository repository(dir);
+  ObjectId commit, tree;
+  std::vector<ObjectId> parents;
+  int64_t time = 0;
+  ASSERT(repository.ResolveCommit("HEAD", commit));
+  ASSERT(repository.ReadCommit(commit, tree, parents, &time));
+  ASSERT(time > 0);
+
+  Configuration config;
+  BlobScanCache cache;
+  std::unordered_map<std::string, Component *> components;
+  std::unordered_map<std::string, File> files;
+  LoadFileListFromGit(config, components, files, repository, tree, false, true, &cache);
+  ASSERT(files.size() == 2);
+  ASSERT(files.find("./lib/a.cpp")->second.rawIncludes.count("a.h") == 1);
+  ASSERT(files.find("./lib/a.h")->second.loc == 1);
+  ASSERT(components.count("./lib") == 1);
+  ASSERT(cache.size() == 2);
+
+  // A second load takes the scan results from the cache instead of the blobs.
+  for (auto& entry : cache) entry.second.loc = 42;
+  files.clear();
+  LoadFileListFromGit(config, components, files, repository, tree, false, true, &cache);
+  ASSERT(files.find("./lib/a.h")->second.loc == 42);
+  for (auto& c : components) delete c.second;
+  std::filesystem::remove_all(dir);
+#endif
+}
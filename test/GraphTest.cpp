@@ -0,0 +1,121 @@
+#include "test.h"
+#include "Graph.h"
+#include <set>
+#include <stdlib.h>
+
+TEST(CondenseNumbersComponentsInReverseTopologicalOrder) {
+  // 0 -> 1 -> 2 -> 1, 2 -> 3
+  Digraph g = MakeDigraph(4, { {0, 1}, {1, 2}, {2, 1}, {2, 3} });
+  Condensation c = Condense(g);
+
+  ASSERT(c.size() == 3);
+  ASSERT(c.componentOf[1] == c.componentOf[2]);
+  ASSERT(c.cyclic[c.componentOf[1]]);
+  ASSERT(!c.cyclic[c.componentOf[0]]);
+  ASSERT(!c.cyclic[c.componentOf[3]]);
+  for (size_t n = 0; n < c.size(); n++) {
+    for (const size_t* it = c.dag.begin(n); it != c.dag.end(n); ++it) {
+      ASSERT(*it < n);
+    }
+  }
+}
+
+TEST(CondenseMarksSelfLoopsAsCyclic) {
+  Digraph g = MakeDigraph(2, { {0, 0}, {0, 1} });
+  Condensation c = Condense(g);
+
+  ASSERT(c.size() == 2);
+  ASSERT(c.cyclic[c.componentOf[0]]);
+  ASSERT(!c.cyclic[c.componentOf[1]]);
+}
+
+TEST(ReachableWeightSumsCountsDiamondOnce) {
+  // 0 -> 1 -> 3, 0 -> 2 -> 3
+  Digraph g = MakeDigraph(4, { {0, 1}, {0, 2}, {1, 3}, {2, 3} });
+  Condensation c = Condense(g);
+  std::vector<uint64_t> weights(c.size());
+  for (size_t n = 0; n < 4; n++) weights[c.componentOf[n]] = size_t(1) << n;
+
+  std::vector<uint64_t> reachable = ReachableWeightSums(c, weights);
+  std::vector<uint64_t> reaching = ReachingWeightSums(c, weights);
+
+  ASSERT(reachable[c.componentOf[0]] == 2 + 4 + 8);
+  ASSERT(reachable[c.componentOf[1]] == 8);
+  ASSERT(reachable[c.componentOf[3]] == 0);
+  ASSERT(reaching[c.componentOf[3]] == 1 + 2 + 4);
+  ASSERT(reaching[c.componentOf[0]] == 0);
+}
+
+TEST(ReachableWeightSumsMatchesBruteForceOnLargeRandomGraph) {
+  const size_t n = 1500;
+  srand(42);
+  std::vector<std::pair<size_t, size_t>> edges;
+  for (size_t e = 0; e < 3 * n; e++) {
+    edges.push_back(std::make_pair(rand() % n, rand() % n));
+  }
+  Digraph g = MakeDigraph(n, edges);
+  Condensation c = Condense(g);
+  std::vector<uint64_t> weights(c.size(), 0);
+  for (size_t node = 0; node < n; node++) weights[c.componentOf[node]] += node;
+
+  std::vector<uint64_t> reachable = ReachableWeightSums(c, weights);
+  std::vector<uint64_t> reaching = ReachingWeightSums(c, weights);
+  std::vector<uint64_t> expectedReaching(n, 0);
+  for (size_t node = 0; node < n; node++) {
+    std::set<size_t> seen;
+    std::vector<size_t> todo(1, node);
+    while (!todo.empty()) {
+      size_t current = todo.back();
+      todo.pop_back();
+      for (const size_t* it = g.begin(current); it != g.end(current); ++it) {
+        if (seen.insert(*it).second) todo.push_back(*it);
+      }
+    }
+    uint64_t total = 0;
+    for (auto& s : seen) {
+      total += s;
+      expectedReaching[s] += node;
+    }
+    ASSERT(reachable[c.componentOf[node]] == total);
+  }
+  for (size_t node = 0; node < n; node++) {
+    ASSERT(reaching[c.componentOf[node]] == expectedReaching[node]);
+  }
+}
+
+TEST(BetweennessCountsPathsThroughNode) {
+  // 0 -> 2, 1 -> 2, 2 -> 3, 2 -> 4: node 2 is on the four paths from {0,1} to {3,4}
+  Digraph g = MakeDigraph(5, { {0, 2}, {1, 2}, {2, 3}, {2, 4} });
+  std::vector<double> b = BetweennessCentrality(g, 0);
+
+  ASSERT(b[2] == 4);
+  ASSERT(b[0] == 0 && b[1] == 0 && b[3] == 0 && b[4] == 0);
+}
+
+TEST(BetweennessSplitsEqualShortestPaths) {
+  // 0 -> 1 -> 3, 0 -> 2 -> 3
+  Digraph g = MakeDigraph(4, { {0, 1}, {0, 2}, {1, 3}, {2, 3} });
+  std::vector<double> b = BetweennessCentrality(g, 0);
+
+  ASSERT(b[1] == 0.5);
+  ASSERT(b[2] == 0.5);
+}
+
+TEST(BetweennessSamplingOfAllNodesIsExact) {
+  Digraph g = MakeDigraph(5, { {0, 2}, {1, 2}, {2, 3}, {3, 4} });
+  std::vector<double> exact = BetweennessCentrality(g, 0);
+  std::vector<double> sampled = BetweennessCentrality(g, 5);
+
+  ASSERT(exact == sampled);
+}
+
+TEST(PageRankFavoursSharedDependency) {
+  Digraph g = MakeDigraph(4, { {0, 3}, {1, 3}, {2, 3} });
+  std::vector<double> rank = PageRank(g, 0.85);
+
+  double total = 0;
+  for (auto& r : rank) total += r;
+  ASSERT(total > 0.999 && total < 1.001);
+  ASSERT(rank[3] > rank[0]);
+  ASSERT(rank[0] == rank[1]);
+}
@@ -74,3 +74,43 @@ TEST(Input_Aliases)
     }
   }
 }
+
+TEST(Input_CmakeListsSections)
+{
+  TemporaryWorkingDirectory workDir(name);
+
+  std::filesystem::create_directories(workDir() / "Lib");
+  {
+    std::ofstream out(workDir() / "Lib" / "CMakeLists.txt");
+    out << "# GENERATED BY CPP-DEPENDENCIES - do not edit, your changes will be lost\n"
+        << "project(Lib CXX)\n"
+        << "add_library(${PROJECT_NAME} STATIC lib.cpp)\n"
+        << "target_link_libraries(${PROJECT_NAME}\n"
+        << "  PUBLIC\n"
+        << "    Other\n"
+        << ")\n"
+        << "set_target_properties(${PROJECT_NAME} PROPERTIES\n"
+        << "  OUTPUT_NAME \"lib name\"\n"
+        << ")\n"
+        << "add_executable(tool\n"
+        << "  tool.cpp\n"
+        << "  WIN32\n"
+        << ")\n";
+  }
+
+  Configuration config;
+  config.reuseCustomSections = true;
+  std::unordered_map<std::string, Component*> components;
+  std::unordered_map<std::string, File> files;
+  LoadFileList(config, components, files, workDir(), false, false);
+
+  const Component& comp = *components.at("./Lib");
+  ASSERT(comp.recreate);
+  ASSERT(comp.name == "Lib");
+  ASSERT(comp.type == "add_executable");
+  ASSERT(comp.additionalTargetParameters == "  WIN32\n");
+  ASSERT(comp.additionalCmakeDeclarations ==
+         "set_target_properties(${PROJECT_NAME} PROPERTIES\n"
+         "  OUTPUT_NAME \"lib name\"\n"
+         ")\n");
+}
@@ -0,0 +1,46 @@
+#include "test.h"
+#include "Component.h"
+#include "MemoryStats.h"
+#include <memory>
+
+// Keeps the compiler from leaving out the allocation of a block that is never used.
+static char* volatile allocatedBlock;
+
+TEST(MemoryStatsCountsHeapAndEstimatesContainers) {
+  EnableMemoryStats();
+  HeapCounters before = ReadHeapCounters();
+  {
+    std::unique_ptr<char[]> block(new char[1 << 20]);
+    allocatedBlock = block.get();
+    HeapCounters during = ReadHeapCounters();
+    ASSERT(during.allocations > before.allocations);
+    ASSERT(during.allocatedBytes - before.allocatedBytes >= (1 << 20));
+  }
+  HeapCounters after = ReadHeapCounters();
+  ASSERT(after.freedBytes - before.freedBytes >= (1 << 20));
+
+#ifdef __linux__
+  uint64_t rss = 0, peak = 0;
+  ASSERT(ReadResidentSetSize(rss, peak));
+  ASSERT(rss > 0 && peak >= rss);
+#endif
+
+  std::unordered_map<std::string, File> files;
+  File& f = files.insert(std::make_pair("./a/a.cpp", File("./a/a.cpp"))).first->second;
+  f.AddIncludeStmt(false, "a/a_header_with_a_name_too_long_for_a_short_string.h");
+  std::unordered_map<std::string, Component *> components;
+  std::unordered_map<std::string, std::string> includeLookup = { { "a.cpp", "./a/a.cpp" } };
+  std::map<std::string, std::set<std::string>> collisions;
+  std::map<std::string, std::vector<std::string>> ambiguous;
+  std::vector<ContainerEstimate> estimates = EstimateContainers(files, components, includeLookup, collisions, ambiguous);
+  bool sawRawIncludes = false;
+  for (auto& e : estimates) {
+    if (e.name == "File::rawIncludes") {
+      sawRawIncludes = true;
+      ASSERT(e.elements == 1);
+      ASSERT(e.bytes > 50);
+    }
+    if (e.name == "includeLookup") ASSERT(e.elements == 1);
+  }
+  ASSERT(sawRawIncludes);
+}
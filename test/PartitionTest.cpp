@@ -0,0 +1,77 @@
+#include "test.h"
+#include "Analysis.h"
+#include "Partition.h"
+#include <stdlib.h>
+
+TEST(PartitionGraphCutsTheBridgeBetweenTwoClusters) {
+  // Two cliques of five nodes joined by the single edge 4 -> 5.
+  std::vector<std::pair<size_t, size_t>> edges;
+  for (size_t a = 0; a < 5; a++) {
+    for (size_t b = 0; b < 5; b++) {
+      if (a != b) {
+        edges.push_back(std::make_pair(a, b));
+        edges.push_back(std::make_pair(a + 5, b + 5));
+      }
+    }
+  }
+  edges.push_back(std::make_pair(4, 5));
+  WeightedGraph g = MakeWeightedGraph(MakeDigraph(10, edges), std::vector<uint64_t>(10, 1));
+
+  std::vector<size_t> part = PartitionGraph(g, 2);
+
+  ASSERT(CutWeight(g, part) == 1);
+  for (size_t n = 1; n < 5; n++) {
+    ASSERT(part[n] == part[0]);
+    ASSERT(part[n + 5] == part[5]);
+  }
+  ASSERT(part[0] != part[5]);
+}
+
+TEST(PartitionGraphBalancesLargeClusteredGraph) {
+  // Four clusters of 2000 nodes with random edges inside and a few between them.
+  const size_t clusterSize = 2000, n = 4 * clusterSize;
+  srand(7);
+  std::vector<std::pair<size_t, size_t>> edges;
+  for (size_t e = 0; e < 4 * n; e++) {
+    size_t cluster = rand() % 4;
+    edges.push_back(std::make_pair(cluster * clusterSize + rand() % clusterSize, cluster * clusterSize + rand() % clusterSize));
+  }
+  for (size_t e = 0; e < 40; e++) {
+    edges.push_back(std::make_pair(rand() % n, rand() % n));
+  }
+  WeightedGraph g = MakeWeightedGraph(MakeDigraph(n, edges), std::vector<uint64_t>(n, 1));
+
+  std::vector<size_t> part = PartitionGraph(g, 4);
+
+  std::vector<size_t> sizes(4, 0);
+  for (auto& p : part) sizes[p]++;
+  for (auto& s : sizes) {
+    ASSERT(s > clusterSize * 9 / 10 && s < clusterSize * 11 / 10);
+  }
+  ASSERT(CutWeight(g, part) < 200);
+}
+
+TEST(SuggestMergesPrefersPartnerWithoutCycle) {
+  Component* tiny = new Component("./tiny");
+  Component* big = new Component("./big");
+  Component* other = new Component("./other");
+  File* t = new File("./tiny/t.h");
+  File* b = new File("./big/b.h");
+  File* o = new File("./other/o.h");
+  // tiny uses big three times and other once, but tiny also reaches big through other.
+  tiny->privDeps = { big, other };
+  tiny->includeReasons[big] = { {t, b}, {t, b}, {t, b} };
+  tiny->includeReasons[other] = { {t, o} };
+  other->pubDeps = { big };
+  other->includeReasons[big] = { {o, b} };
+  big->pubLinks = { other };
+  big->privLinks = { tiny };
+  other->privLinks = { tiny };
+
+  std::vector<MergeSuggestion> merges = SuggestMerges(std::vector<Component*>(1, tiny));
+
+  ASSERT(merges.size() == 1);
+  ASSERT(merges[0].partner == other);
+  ASSERT(merges[0].includes == 1);
+  ASSERT(!merges[0].createsCycle);
+}
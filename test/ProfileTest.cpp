@@ -0,0 +1,47 @@
+#include "test.h"
+#include "Graph.h"
+#include "Profile.h"
+#include <sstream>
+#include <thread>
+
+TEST(ProfileRecordsStagesCountersAndTrace) {
+  EnableProfiling();
+  {
+    ProfileScope stage("ProfileTestStage");
+    ASSERT(CurrentProfileStage() == "ProfileTestStage");
+    {
+      ProfileScope detail("ProfileTestDetail", ProfileScope::Detail);
+    }
+    ParallelFor(4, [](size_t, size_t) {});
+  }
+  // Every new thread running worker 0 of a parallel loop shares one trace track.
+  for (int n = 0; n < 8; n++) {
+    std::thread([]() { ProfileScope span("ProfileTestWorker", ProfileScope::Worker, 0); }).join();
+  }
+  ASSERT(CurrentProfileStage().empty());
+  CountProfile("profile test count", 2);
+  CountProfile("profile test count", 3);
+  SetProfileValue("profile test size", 7);
+
+  std::ostringstream summary;
+  const std::ios_base::fmtflags flags = summary.flags();
+  PrintProfile(summary);
+  ASSERT(summary.flags() == flags);
+  ASSERT(summary.precision() == 6);
+  ASSERT(summary.str().find("ProfileTestStage") != std::string::npos);
+  ASSERT(summary.str().find("ProfileTestDetail") != std::string::npos);
+  ASSERT(summary.str().find("profile test count") != std::string::npos);
+
+  std::ostringstream trace;
+  WriteChromeTrace(trace);
+  const std::string json = trace.str();
+  ASSERT(json.find("\"name\":\"ProfileTestStage\"") != std::string::npos);
+  // Details only add up in the summary.
+  ASSERT(json.find("\"name\":\"ProfileTestDetail\"") == std::string::npos);
+  ASSERT(json.find("\"profile test count\":5") != std::string::npos);
+  ASSERT(json.find("\"profile test size\":7") != std::string::npos);
+  ASSERT(json.find("\"name\":\"ProfileTestWorker\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":1,") != std::string::npos);
+  size_t tracks = 0;
+  for (size_t at = json.find("thread_name"); at != std::string::npos; at = json.find("thread_name", at + 1)) tracks++;
+  ASSERT(tracks <= WorkerCount() + 1);
+}
@@ -0,0 +1,98 @@
+#include "test.h"
+#include "Configuration.h"
+#include "Snapshot.h"
+#include <sstream>
+
+static Snapshot MakeBaseline() {
+  Snapshot s;
+  s.components = { "app", "core", "util" };
+  s.componentEdges = { { 0, 1 }, { 1, 2 } };
+  s.files = { "./app/main.cpp", "./core/core.h", "./util/util h.h" };
+  s.fileEdges = { { 0, 1 }, { 1, 2 } };
+  s.fileImpact = { 0, 30, 20 };
+  return s;
+}
+
+TEST(SnapshotRoundTrip) {
+  Snapshot s = MakeBaseline();
+  std::stringstream stream;
+  WriteSnapshot(stream, s);
+  Snapshot read;
+  ASSERT(ReadSnapshot(stream, read));
+  ASSERT(read.components == s.components);
+  ASSERT(read.componentEdges == s.componentEdges);
+  ASSERT(read.files == s.files);
+  ASSERT(read.fileEdges == s.fileEdges);
+  ASSERT(read.fileImpact == s.fileImpact);
+
+  std::istringstream broken("cpp-dependencies snapshot 1\ncomponents 1\na\nfiles 0\ndependencies 1\n0 3\nincludes 0\n");
+  ASSERT(!ReadSnapshot(broken, read));
+}
+
+TEST(DiffSnapshotsReportsNewCycleAndImpact) {
+  Snapshot before = MakeBaseline();
+  // "base" sorts before the existing names, so every index shifts in the new snapshot.
+  Snapshot after;
+  after.components = { "app", "base", "core", "util" };
+  after.componentEdges = { { 0, 2 }, { 2, 1 }, { 2, 3 }, { 3, 2 } };
+  after.files = { "./app/main.cpp", "./base/base.h", "./core/core.h", "./util/util h.h" };
+  after.fileEdges = { { 0, 2 }, { 2, 1 }, { 2, 3 } };
+  after.fileImpact = { 0, 5, 30, 45 };
+
+  SnapshotDiff diff = DiffSnapshots(before, after);
+  ASSERT(diff.addedComponents == std::vector<std::string>{ "base" });
+  ASSERT(diff.removedComponents.empty());
+  ASSERT(diff.addedDependencies.size() == 2);
+  ASSERT(diff.addedDependencies[0] == std::make_pair(std::string("core"), std::string("base")));
+  ASSERT(diff.addedDependencies[1] == std::make_pair(std::string("util"), std::string("core")));
+  ASSERT(diff.removedDependencies.empty());
+  ASSERT(diff.addedIncludes.size() == 1);
+  ASSERT(diff.removedIncludes.empty());
+  ASSERT((diff.newlyCyclic == std::vector<std::string>{ "core", "util" }));
+  ASSERT(diff.noLongerCyclic.empty());
+  ASSERT(diff.changedCycles.empty());
+  ASSERT(diff.impactChanges.size() == 2);
+  ASSERT(diff.impactChanges[0].first == "./util/util h.h");
+  ASSERT(diff.impactChanges[0].second == std::make_pair(uint64_t(20), uint64_t(45)));
+  ASSERT(diff.impactChanges[1].first == "./base/base.h");
+  ASSERT(diff.totalImpactBefore == 50);
+  ASSERT(diff.totalImpactAfter == 80);
+
+  // Pulling app into the cycle changes it rather than creating a new one.
+  Snapshot later = after;
+  later.componentEdges = { { 0, 2 }, { 2, 0 }, { 2, 1 }, { 2, 3 } };
+  SnapshotDiff grown = DiffSnapshots(after, later);
+  ASSERT(grown.newlyCyclic == std::vector<std::string>{ "app" });
+  ASSERT(grown.noLongerCyclic == std::vector<std::string>{ "util" });
+  ASSERT(grown.changedCycles.size() == 1);
+  ASSERT(grown.changedCycles[0].joined == std::vector<std::string>{ "app" });
+  ASSERT(grown.changedCycles[0].left == std::vector<std::string>{ "util" });
+}
+
+TEST(CheckBudgetFlagsRegressionsBeyondTolerance) {
+  Configuration config;
+  config.budgetImpactTolerance = 10;
+  config.budgetImpactSlack = 5;
+  Snapshot before = MakeBaseline();
+  Snapshot after = before;
+  after.fileImpact = { 0, 32, 40 };
+  std::vector<BudgetViolation> violations = CheckBudget(config, before, after);
+  ASSERT(violations.size() == 2);
+  ASSERT(violations[0].kind == BudgetViolation::TotalImpact);
+  ASSERT(violations[1].kind == BudgetViolation::Impact);
+  ASSERT(violations[1].name == "./util/util h.h");
+
+  after.fileImpact = { 0, 32, 21 };
+  after.componentEdges = { { 0, 1 }, { 0, 2 }, { 1, 2 }, { 2, 1 } };
+  violations = CheckBudget(config, before, after);
+  ASSERT(violations.size() == 4);
+  ASSERT(violations[0].kind == BudgetViolation::FanOut);
+  ASSERT(violations[0].name == "app");
+  ASSERT(violations[0].before == 1 && violations[0].after == 2);
+  ASSERT(violations[1].kind == BudgetViolation::FanOut && violations[1].name == "util");
+  ASSERT(violations[2].kind == BudgetViolation::Cycle && violations[2].name == "core");
+  ASSERT(violations[3].kind == BudgetViolation::Cycle && violations[3].name == "util");
+
+  config.budgetFanOutTolerance = 1;
+  ASSERT(CheckBudget(config, before, after).size() == 2);
+}
@@ -1,6 +1,14 @@
 #pragma once
 
+#include "Component.h"
 #include <filesystem>
+#include <string>
+#include <unordered_map>
+
+// Adds a file to files and returns it. Tests set its lines, component and dependencies themselves.
+inline File* AddFile(std::unordered_map<std::string, File>& files, const std::string& name) {
+  return &files.insert(std::make_pair(name, File(name))).first->second;
+}
 
 class TemporaryWorkingDirectory
 {